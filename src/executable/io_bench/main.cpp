@@ -0,0 +1,832 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if defined(__x86_64__)
+    #include <x86intrin.h>
+#endif
+
+#include <library/io.h>
+#include <library/io/packet_record.h>
+
+
+namespace
+{
+
+    using namespace maniscalco;
+    using size_type = std::int64_t;
+    using code_type = std::uint64_t;
+
+    // width 0 denotes a random width in [1, 64] per code
+    static size_type constexpr random_width = 0;
+
+    enum class operation
+    {
+        push,
+        pop,
+        peek,       // peek then discard
+        pop_bit,    // width 1 only
+        discard,
+        push_bits,  // the bits of the code set copied as one span
+        pop_bits    // pop_stream only
+    };
+
+    // engine used by the read operations
+    enum class reader
+    {
+        pop_stream,
+        bit_reader
+    };
+
+    // how the streams call their handlers (memory sink only for policy)
+    enum class dispatch
+    {
+        function,   // push_stream / pop_stream (std::function)
+        policy      // basic_push_stream / basic_pop_stream
+    };
+
+    enum class sink
+    {
+        memory,
+        file,
+        mmap,
+        container,
+        direct      // O_DIRECT
+    };
+
+    struct settings
+    {
+        size_type numCodes_{1 << 20};
+        size_type warmUp_{1};
+        size_type repetitions_{5};
+        std::string directory_{"/tmp"};
+        bool quick_{false};
+    };
+
+    struct benchmark_case
+    {
+        io::stream_direction direction_;
+        operation operation_;
+        size_type width_;
+        size_type bufferSize_;
+        sink sink_;
+        reader reader_{reader::pop_stream};
+        dispatch dispatch_{dispatch::function};
+        // push_bits/pop_bits: bits pushed ahead of the span.  a multiple of 8
+        // takes the byte copy path and anything else the shift and merge path.
+        size_type bitOffset_{0};
+    };
+
+    struct measurement
+    {
+        std::chrono::nanoseconds elapsed_;
+        std::uint64_t cycles_;
+        bool valid_;
+    };
+
+
+    //=========================================================================
+    char const * to_string
+    (
+        operation value
+    )
+    {
+        switch (value)
+        {
+            case operation::push: return "push";
+            case operation::pop: return "pop";
+            case operation::peek: return "peek";
+            case operation::pop_bit: return "pop_bit";
+            case operation::discard: return "discard";
+            case operation::push_bits: return "push_bits";
+            case operation::pop_bits: return "pop_bits";
+        }
+        return "";
+    }
+
+
+    //=========================================================================
+    char const * to_string
+    (
+        reader value
+    )
+    {
+        switch (value)
+        {
+            case reader::pop_stream: return "pop_stream";
+            case reader::bit_reader: return "bit_reader";
+        }
+        return "";
+    }
+
+
+    //=========================================================================
+    char const * to_string
+    (
+        dispatch value
+    )
+    {
+        switch (value)
+        {
+            case dispatch::function: return "function";
+            case dispatch::policy: return "policy";
+        }
+        return "";
+    }
+
+
+    //=========================================================================
+    char const * to_string
+    (
+        sink value
+    )
+    {
+        switch (value)
+        {
+            case sink::memory: return "memory";
+            case sink::file: return "file";
+            case sink::mmap: return "mmap";
+            case sink::container: return "container";
+            case sink::direct: return "direct";
+        }
+        return "";
+    }
+
+
+    //=========================================================================
+    inline std::uint64_t read_cycle_counter
+    (
+        // reference cycles (tsc) where available.  zero otherwise.
+    )
+    {
+        #if defined(__x86_64__)
+            return __rdtsc();
+        #else
+            return 0;
+        #endif
+    }
+
+
+    //=========================================================================
+    struct code_set
+    {
+        // codes and their widths in push order
+        code_set
+        (
+            size_type width,
+            size_type count
+        ):
+            codes_(count),
+            widths_(count)
+        {
+            std::mt19937_64 generator(width + 1);
+            for (auto i = 0; i < count; ++i)
+            {
+                auto w = (width == random_width) ? (size_type)((generator() % 64) + 1) : width;
+                widths_[i] = w;
+                codes_[i] = generator() & ((w == 64) ? ~0ull : ((1ull << w) - 1));
+                totalBits_ += w;
+                checksum_ += codes_[i];
+            }
+        }
+
+        std::vector<code_type> codes_;
+        std::vector<size_type> widths_;
+        size_type totalBits_{0};
+        code_type checksum_{0};
+    };
+
+
+    //=========================================================================
+    template <io::stream_direction S>
+    class packet_sink final
+    {
+    public:
+
+        // owns the packets written by a push_stream and hands them back to a pop_stream
+        using packet_type = io::stream_packet<S>;
+
+        packet_sink
+        (
+            sink kind,
+            std::string const & directory,
+            size_type bufferSize
+        ):
+            kind_(kind),
+            path_(directory + "/io_bench_" + to_string(kind) + ".dat"),
+            bufferSize_(bufferSize)
+        {
+            switch (kind_)
+            {
+                case sink::memory:
+                    break;
+                case sink::file:
+                    fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+                    if (fd_ < 0)
+                        throw std::runtime_error("io_bench: failed to open " + path_);
+                    break;
+                case sink::mmap:
+                    mmapOutput_.emplace(typename io::mmap_file_output_handler<S>::configuration_type{.path_ = path_});
+                    break;
+                case sink::container:
+                    containerOutput_.emplace(typename io::container_output_handler<S>::configuration_type{
+                            .path_ = path_, .bufferSize_ = bufferSize_, .writeIndex_ = false});
+                    break;
+                case sink::direct:
+                    directOutput_.emplace(typename io::direct_file_output_handler<S>::configuration_type{.path_ = path_});
+                    break;
+            }
+        }
+
+        ~packet_sink()
+        {
+            if (fd_ >= 0)
+                ::close(fd_);
+            mmapInput_.reset();
+            containerInput_.reset();
+            directInput_.reset();
+            if (kind_ != sink::memory)
+                ::unlink(path_.c_str());
+        }
+
+        packet_sink(packet_sink const &) = delete;
+        packet_sink & operator = (packet_sink const &) = delete;
+
+        std::function<void(packet_type)> output_handler()
+        {
+            switch (kind_)
+            {
+                case sink::memory: return [this](auto packet){packets_.emplace_back(std::move(packet));};
+                case sink::file: return [this](auto packet){write_record(packet);};
+                case sink::mmap: return *mmapOutput_;
+                case sink::container: return *containerOutput_;
+                case sink::direct: return *directOutput_;
+            }
+            return nullptr;
+        }
+
+        std::function<packet_type()> input_handler()
+        {
+            switch (kind_)
+            {
+                case sink::memory:
+                    return [this]()
+                            {
+                                if (packets_.empty())
+                                    return packet_type{};
+                                auto packet = std::move(packets_.front());
+                                packets_.pop_front();
+                                return packet;
+                            };
+                case sink::file:
+                    ::lseek(fd_, 0, SEEK_SET);
+                    return [this](){return read_record();};
+                case sink::mmap:
+                    mmapOutput_->close();
+                    mmapInput_.emplace(typename io::mmap_file_input_handler<S>::configuration_type{.path_ = path_});
+                    return *mmapInput_;
+                case sink::container:
+                    containerOutput_->close();
+                    containerInput_.emplace(typename io::container_input_handler<S>::configuration_type{.path_ = path_});
+                    return *containerInput_;
+                case sink::direct:
+                    directOutput_->close();
+                    directInput_.emplace(typename io::direct_file_input_handler<S>::configuration_type{.path_ = path_});
+                    return *directInput_;
+            }
+            return nullptr;
+        }
+
+        // the packets of a memory sink
+        std::deque<packet_type> & packets()
+        {
+            return packets_;
+        }
+
+    private:
+
+        void write_record
+        (
+            packet_type const & packet
+        )
+        {
+            auto header = (io::packet_record::header_type)packet.size();
+            auto [data, numBytes] = io::packet_record::bytes(packet);
+            iovec iov[2] = {{&header, sizeof(header)}, {const_cast<std::uint8_t *>(data), (std::size_t)numBytes}};
+            if (::writev(fd_, iov, 2) != (ssize_t)(sizeof(header) + numBytes))
+                throw std::runtime_error("io_bench: write failed");
+        }
+
+        packet_type read_record()
+        {
+            io::packet_record::header_type numBits;
+            if (::read(fd_, &numBits, sizeof(numBits)) != sizeof(numBits))
+                return {};
+            auto numBytes = io::packet_record::byte_count(numBits);
+            buffer data(std::max(bufferSize_, numBytes));
+            auto offset = io::packet_record::data_offset<S>(data.capacity(), numBytes);
+            if (::read(fd_, data.data() + offset, numBytes) != numBytes)
+                throw std::runtime_error("io_bench: truncated record");
+            return io::packet_record::make_packet<S>(std::move(data), numBits);
+        }
+
+        sink const kind_;
+
+        std::string const path_;
+
+        size_type const bufferSize_;
+
+        int fd_{-1};
+
+        std::deque<packet_type> packets_;
+
+        std::optional<io::mmap_file_output_handler<S>> mmapOutput_;
+
+        std::optional<io::mmap_file_input_handler<S>> mmapInput_;
+
+        std::optional<io::container_output_handler<S>> containerOutput_;
+
+        std::optional<io::container_input_handler<S>> containerInput_;
+
+        std::optional<io::direct_file_output_handler<S>> directOutput_;
+
+        std::optional<io::direct_file_input_handler<S>> directInput_;
+    };
+
+
+    //=========================================================================
+    template <io::stream_direction S>
+    struct memory_sink_policy
+    {
+        void operator()(io::stream_packet<S> packet) const{packets_->emplace_back(std::move(packet));}
+        std::deque<io::stream_packet<S>> * packets_;
+    };
+
+
+    //=========================================================================
+    template <io::stream_direction S>
+    struct memory_source_policy
+    {
+        io::stream_packet<S> operator()() const
+        {
+            if (packets_->empty())
+                return {};
+            auto packet = std::move(packets_->front());
+            packets_->pop_front();
+            return packet;
+        }
+        std::deque<io::stream_packet<S>> * packets_;
+    };
+
+
+    //=========================================================================
+    struct allocator_policy
+    {
+        buffer operator()() const{return buffer(bufferSize_);}
+        size_type bufferSize_;
+    };
+
+
+    //=========================================================================
+    template <typename T>
+    inline std::optional<code_type> try_peek
+    (
+        T const & stream,
+        size_type width
+    )
+    {
+        return stream.peek(width);
+    }
+
+
+    //=========================================================================
+    template <io::stream_direction S>
+    inline std::optional<code_type> try_peek
+    (
+        // bit_reader peek always succeeds up to max_peek_size bits
+        io::bit_reader<S> & stream,
+        size_type width
+    )
+    {
+        if (width <= io::bit_reader<S>::max_peek_size)
+            return stream.peek(width);
+        return std::nullopt;
+    }
+
+
+    //=========================================================================
+    template <io::stream_direction S>
+    inline bool decode_codes
+    (
+        // peek then consume via bit_reader::decode_n where every code fits in
+        // the window.  returns false (having read nothing) otherwise.
+        io::bit_reader<S> & stream,
+        code_set const & codeSet,
+        code_type & checksum
+    )
+    {
+        auto const * widths = codeSet.widths_.data();
+        auto count = (size_type)codeSet.widths_.size();
+        if (std::any_of(widths, widths + count, [](auto w){return (w > io::bit_reader<S>::max_peek_size);}))
+            return false;
+        stream.decode_n(count, [&](code_type window)
+                {
+                    auto width = *widths++;
+                    if constexpr (S == io::stream_direction::forward)
+                        checksum += (window >> (io::bit_reader<S>::max_peek_size - width));
+                    else
+                        checksum += (window & ((1ull << width) - 1));
+                    return width;
+                });
+        return true;
+    }
+
+
+    //=========================================================================
+    template <typename T>
+    inline bool decode_codes
+    (
+        T &,
+        code_set const &,
+        code_type &
+    )
+    {
+        return false;
+    }
+
+
+    //=========================================================================
+    template <typename T>
+    code_type read_codes
+    (
+        // consume the stream using the path under test.  returns the checksum
+        // of the codes read (order independent so that both directions agree)
+        T & stream,
+        code_set const & codeSet,
+        operation op
+    )
+    {
+        code_type checksum = 0;
+        auto const * widths = codeSet.widths_.data();
+        auto count = (size_type)codeSet.widths_.size();
+        switch (op)
+        {
+            case operation::pop:
+                for (auto i = 0; i < count; ++i)
+                    checksum += stream.pop(widths[i]);
+                break;
+            case operation::peek:
+                if (decode_codes(stream, codeSet, checksum))
+                    break;
+                for (auto i = 0; i < count; ++i)
+                {
+                    if (auto code = try_peek(stream, widths[i]); code)
+                    {
+                        checksum += *code;
+                        stream.discard(widths[i]);
+                    }
+                    else
+                    {
+                        checksum += stream.pop(widths[i]);
+                    }
+                }
+                break;
+            case operation::pop_bit:
+                for (auto i = 0; i < count; ++i)
+                    checksum += stream.pop_bit();
+                break;
+            case operation::discard:
+                for (auto i = 0; i < count; ++i)
+                    stream.discard(widths[i]);
+                checksum = codeSet.checksum_;
+                break;
+            case operation::push:
+            case operation::push_bits:
+            case operation::pop_bits:
+                break;
+        }
+        return checksum;
+    }
+
+
+    //=========================================================================
+    template <typename T>
+    bool read_bits
+    (
+        // pop the span written by push_bits into destination and compare it
+        // with the bits of the code set.  false for readers without pop_bits.
+        T & stream,
+        code_set const & codeSet,
+        size_type bitOffset,
+        std::vector<std::uint8_t> & destination
+    )
+    {
+        if constexpr (requires {stream.pop_bits(destination.data(), bitOffset);})
+        {
+            auto const * source = (std::uint8_t const *)codeSet.codes_.data();
+            if (bitOffset > 0)
+                stream.pop(bitOffset);
+            stream.pop_bits(destination.data(), codeSet.totalBits_);
+            auto wholeBytes = (codeSet.totalBits_ / 8);
+            auto mask = (std::uint8_t)(0xff00 >> (codeSet.totalBits_ % 8));
+            return ((std::memcmp(destination.data(), source, wholeBytes) == 0) && 
+                    (((mask == 0) || ((destination[wholeBytes] & mask) == (source[wholeBytes] & mask)))));
+        }
+        return false;
+    }
+
+
+    //=========================================================================
+    template <io::stream_direction S>
+    measurement measure
+    (
+        // one repetition.  push all codes then (for read operations) read
+        // them back.  only the phase under test is timed.
+        benchmark_case const & benchmarkCase,
+        code_set const & codeSet,
+        settings const & config
+    )
+    {
+        packet_sink<S> packetSink(benchmarkCase.sink_, config.directory_, benchmarkCase.bufferSize_);
+
+        auto bufferSize = benchmarkCase.bufferSize_;
+        auto policy = (benchmarkCase.dispatch_ == dispatch::policy);
+        auto bulk = ((benchmarkCase.operation_ == operation::push_bits) || (benchmarkCase.operation_ == operation::pop_bits));
+        auto write = [&](auto & stream)
+                {
+                    if (bulk)
+                    {
+                        // the first totalBits_ bits of the code array
+                        if (benchmarkCase.bitOffset_ > 0)
+                            stream.push(0, benchmarkCase.bitOffset_);
+                        stream.push_bits((std::uint8_t const *)codeSet.codes_.data(), 0, codeSet.totalBits_);
+                        return;
+                    }
+                    auto const * codes = codeSet.codes_.data();
+                    auto const * widths = codeSet.widths_.data();
+                    for (auto i = 0ull; i < codeSet.codes_.size(); ++i)
+                        stream.push(codes[i], widths[i]);
+                };
+        auto pushStart = std::chrono::steady_clock::now();
+        auto pushCycles = read_cycle_counter();
+        if (policy)
+        {
+            io::basic_push_stream<S, memory_sink_policy<S>, allocator_policy> pushStream({
+                    .bufferOutputHandler_ = {&packetSink.packets()},
+                    .bufferAllocationHandler_ = {bufferSize}});
+            write(pushStream);
+        }
+        else
+        {
+            io::push_stream<S> pushStream({
+                    .bufferOutputHandler_ = packetSink.output_handler(),
+                    .bufferAllocationHandler_ = [bufferSize](){return buffer(bufferSize);}});
+            write(pushStream);
+        }
+        pushCycles = (read_cycle_counter() - pushCycles);
+        auto pushElapsed = (std::chrono::steady_clock::now() - pushStart);
+        if ((benchmarkCase.operation_ == operation::push) || (benchmarkCase.operation_ == operation::push_bits))
+            return {pushElapsed, pushCycles, true};
+
+        std::vector<std::uint8_t> destination(bulk ? ((codeSet.totalBits_ + 7) / 8) : 0);
+        auto read = [&](auto & stream) -> measurement
+                {
+                    if (benchmarkCase.operation_ == operation::pop_bits)
+                    {
+                        auto popStart = std::chrono::steady_clock::now();
+                        auto popCycles = read_cycle_counter();
+                        auto valid = read_bits(stream, codeSet, benchmarkCase.bitOffset_, destination);
+                        popCycles = (read_cycle_counter() - popCycles);
+                        return {std::chrono::steady_clock::now() - popStart, popCycles, valid};
+                    }
+                    auto popStart = std::chrono::steady_clock::now();
+                    auto popCycles = read_cycle_counter();
+                    auto checksum = read_codes(stream, codeSet, benchmarkCase.operation_);
+                    popCycles = (read_cycle_counter() - popCycles);
+                    return {std::chrono::steady_clock::now() - popStart, popCycles, (checksum == codeSet.checksum_)};
+                };
+        if (benchmarkCase.reader_ == reader::bit_reader)
+        {
+            io::bit_reader<S> bitReader({packetSink.input_handler()});
+            return read(bitReader);
+        }
+        if (policy)
+        {
+            io::basic_pop_stream<S, memory_source_policy<S>> popStream({memory_source_policy<S>{&packetSink.packets()}});
+            return read(popStream);
+        }
+        io::pop_stream<S> popStream({packetSink.input_handler()});
+        return read(popStream);
+    }
+
+
+    //=========================================================================
+    void report
+    (
+        std::ostream & stream,
+        benchmark_case const & benchmarkCase,
+        code_set const & codeSet,
+        std::vector<measurement> measurements,
+        bool first
+    )
+    {
+        auto count = (double)codeSet.codes_.size();
+        std::sort(measurements.begin(), measurements.end(), [](auto const & a, auto const & b){return (a.elapsed_ < b.elapsed_);});
+        auto const & best = measurements.front();
+        auto const & median = measurements[measurements.size() / 2];
+        auto valid = std::all_of(measurements.begin(), measurements.end(), [](auto const & m){return m.valid_;});
+        auto seconds = std::chrono::duration<double>(best.elapsed_).count();
+
+        stream << (first ? "\n" : ",\n") << "    {" <<
+                "\"operation\": \"" << to_string(benchmarkCase.operation_) << "\", " <<
+                "\"direction\": \"" << ((benchmarkCase.direction_ == io::stream_direction::forward) ? "forward" : "reverse") << "\", " <<
+                "\"width\": ";
+        if (benchmarkCase.width_ == random_width)
+            stream << "\"random\", ";
+        else
+            stream << benchmarkCase.width_ << ", ";
+        stream << "\"buffer_size\": " << benchmarkCase.bufferSize_ << ", " <<
+                "\"sink\": \"" << to_string(benchmarkCase.sink_) << "\", " <<
+                "\"reader\": \"" << to_string(benchmarkCase.reader_) << "\", " <<
+                "\"dispatch\": \"" << to_string(benchmarkCase.dispatch_) << "\", " <<
+                "\"bit_offset\": " << benchmarkCase.bitOffset_ << ", " <<
+                "\"codes\": " << codeSet.codes_.size() << ", " <<
+                "\"bits\": " << codeSet.totalBits_ << ", " <<
+                "\"repetitions\": " << measurements.size() << ", " <<
+                "\"ns_per_code\": " << (best.elapsed_.count() / count) << ", " <<
+                "\"ns_per_code_median\": " << (median.elapsed_.count() / count) << ", " <<
+                "\"bits_per_cycle\": ";
+        if (best.cycles_ > 0)
+            stream << ((double)codeSet.totalBits_ / best.cycles_);
+        else
+            stream << "null";
+        stream << ", " <<
+                "\"mb_per_sec\": " << (((double)codeSet.totalBits_ / 8 / (1 << 20)) / seconds) << ", " <<
+                "\"valid\": " << std::boolalpha << valid << "}";
+    }
+
+
+    //=========================================================================
+    template <io::stream_direction S>
+    void run
+    (
+        std::ostream & stream,
+        benchmark_case const & benchmarkCase,
+        settings const & config,
+        bool & first
+    )
+    {
+        auto numCodes = config.numCodes_;
+        if (benchmarkCase.operation_ == operation::pop_bit)
+            numCodes *= 8; // comparable number of bits to the other operations at width 8
+        code_set codeSet(benchmarkCase.width_, numCodes);
+        for (auto i = 0; i < config.warmUp_; ++i)
+            measure<S>(benchmarkCase, codeSet, config);
+        std::vector<measurement> measurements;
+        for (auto i = 0; i < config.repetitions_; ++i)
+            measurements.push_back(measure<S>(benchmarkCase, codeSet, config));
+        report(stream, benchmarkCase, codeSet, std::move(measurements), first);
+        first = false;
+    }
+
+
+    //=========================================================================
+    std::vector<benchmark_case> make_cases
+    (
+        settings const & config
+    )
+    {
+        static size_type constexpr default_buffer_size = io::forward_push_stream::default_buffer_size;
+        std::vector<benchmark_case> cases;
+        std::vector<size_type> widths;
+        if (config.quick_)
+            widths = {1, 8, 13, 32, 57, 64, random_width};
+        else
+            for (auto width = 1; width <= 64; ++width)
+                widths.push_back(width);
+        if (!config.quick_)
+            widths.push_back(random_width);
+
+        for (auto direction : {io::stream_direction::forward, io::stream_direction::reverse})
+        {
+            // every width on the default configuration
+            for (auto width : widths)
+                for (auto op : {operation::push, operation::pop, operation::peek, operation::discard})
+                    cases.push_back({direction, op, width, default_buffer_size, sink::memory});
+            cases.push_back({direction, operation::pop_bit, 1, default_buffer_size, sink::memory});
+
+            // the same read operations using bit_reader
+            for (auto width : widths)
+                for (auto op : {operation::pop, operation::peek, operation::discard})
+                    cases.push_back({direction, op, width, default_buffer_size, sink::memory, reader::bit_reader});
+            cases.push_back({direction, operation::pop_bit, 1, default_buffer_size, sink::memory, reader::bit_reader});
+
+            // buffer sizes and sinks at representative widths
+            for (auto width : {13ll, (long long)random_width})
+            {
+                for (auto bufferSize : {1ll << 8, 1ll << 10, 1ll << 16, 1ll << 20})
+                    for (auto op : {operation::push, operation::pop})
+                        cases.push_back({direction, op, width, bufferSize, sink::memory});
+                // static dispatch matters most where packets are small
+                for (auto bufferSize : {1ll << 8, 1ll << 10})
+                    for (auto op : {operation::push, operation::pop})
+                        cases.push_back({direction, op, width, bufferSize, sink::memory, reader::pop_stream, dispatch::policy});
+                for (auto kind : {sink::file, sink::mmap, sink::container, sink::direct})
+                    for (auto op : {operation::push, operation::pop})
+                        cases.push_back({direction, op, width, default_buffer_size, kind});
+            }
+
+            // bulk copies of the whole code set, byte aligned and not
+            for (auto bitOffset : {0ll, 3ll})
+                for (auto op : {operation::push_bits, operation::pop_bits})
+                    cases.push_back({direction, op, 64, default_buffer_size, sink::memory, 
+                            reader::pop_stream, dispatch::function, bitOffset});
+        }
+        return cases;
+    }
+
+
+    //=========================================================================
+    void usage
+    (
+    )
+    {
+        std::cerr << "usage: io_bench [--codes N] [--warmup N] [--repetitions N] [--directory PATH] [--quick]\n" <<
+                "results are written to stdout as JSON" << std::endl;
+    }
+
+} // namespace
+
+
+//=============================================================================
+int main
+(
+    int argc,
+    char const ** argv
+)
+{
+    settings config;
+    for (auto i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        auto next = [&]() -> std::string
+                {
+                    if (++i >= argc)
+                        throw std::invalid_argument("missing value for " + arg);
+                    return argv[i];
+                };
+        try
+        {
+            if (arg == "--codes")
+                config.numCodes_ = std::stoll(next());
+            else if (arg == "--warmup")
+                config.warmUp_ = std::stoll(next());
+            else if (arg == "--repetitions")
+                config.repetitions_ = std::max(std::stoll(next()), 1ll);
+            else if (arg == "--directory")
+                config.directory_ = next();
+            else if (arg == "--quick")
+                config.quick_ = true;
+            else
+                throw std::invalid_argument("unknown option " + arg);
+        }
+        catch (std::exception const & exception)
+        {
+            std::cerr << exception.what() << std::endl;
+            usage();
+            return 1;
+        }
+    }
+
+    std::cout << "{\n" <<
+            "  \"benchmark\": \"io_bench\",\n" <<
+            "  \"format_version\": 4,\n" <<
+            "  \"settings\": {\"codes\": " << config.numCodes_ << ", \"warmup\": " << config.warmUp_ <<
+            ", \"repetitions\": " << config.repetitions_ << ", \"cycle_counter\": " <<
+            ((read_cycle_counter() != 0) ? "\"tsc\"" : "null") << "},\n" <<
+            "  \"results\": [";
+    auto first = true;
+    for (auto const & benchmarkCase : make_cases(config))
+    {
+        if (benchmarkCase.direction_ == io::stream_direction::forward)
+            run<io::stream_direction::forward>(std::cout, benchmarkCase, config, first);
+        else
+            run<io::stream_direction::reverse>(std::cout, benchmarkCase, config, first);
+        std::cout.flush();
+    }
+    std::cout << "\n  ]\n}" << std::endl;
+    return 0;
+}
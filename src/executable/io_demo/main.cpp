@@ -8,6 +8,7 @@
 #include <fstream>
 #include <iomanip>
 #include <optional>
+#include <vector>
 
 #include <library/io.h>
 
@@ -153,6 +154,64 @@ auto file_stream_test
 }
 
 
+//=============================================================================
+auto mmap_file_stream_test
+(
+    // stream to memory mapped file
+    std::function<maniscalco::buffer()> optionalCustomBufferAllocationHook = nullptr
+)
+{
+    using namespace maniscalco;
+    static auto constexpr path = "/tmp/test_mmap.dat";
+
+    io::mmap_file_output_handler<push_stream_direction> output({.path_ = path});
+    std::optional<io::mmap_file_input_handler<pop_stream_direction>> input;
+
+    return stream_push_pop_test(
+            output,
+            [&]() // packets are seated directly over the mapped file
+            {
+                if (!input)
+                {
+                    output.close();
+                    input.emplace(io::mmap_file_input_handler<pop_stream_direction>::configuration_type{.path_ = path});
+                }
+                return (*input)();
+            },
+            optionalCustomBufferAllocationHook);
+}
+
+
+//=============================================================================
+auto async_mmap_file_stream_test
+(
+    // stream to memory mapped file via background writer thread
+    std::function<maniscalco::buffer()> optionalCustomBufferAllocationHook = nullptr
+)
+{
+    using namespace maniscalco;
+    static auto constexpr path = "/tmp/test_mmap.dat";
+
+    io::mmap_file_output_handler<push_stream_direction> output({.path_ = path});
+    io::async_output_handler<push_stream_direction> asyncOutput({.bufferOutputHandler_ = output});
+    std::optional<io::mmap_file_input_handler<pop_stream_direction>> input;
+
+    return stream_push_pop_test(
+            asyncOutput,
+            [&]()
+            {
+                if (!input)
+                {
+                    asyncOutput.flush(); // wait for writer thread to drain
+                    output.close();
+                    input.emplace(io::mmap_file_input_handler<pop_stream_direction>::configuration_type{.path_ = path});
+                }
+                return (*input)();
+            },
+            optionalCustomBufferAllocationHook);
+}
+
+
 //=============================================================================
 template <typename T>
 void benchmark_test
@@ -180,6 +239,124 @@ void benchmark_test
 }
 
 
+//=============================================================================
+template <std::int64_t N>
+void code_width_benchmark
+(
+    // compare the runtime code size api against the compile time code size api
+)
+{
+    using namespace maniscalco;
+    static auto constexpr num_codes = (1ull << 24);
+    static auto constexpr megabytesProcessed = (((double)num_codes * N) / (1 << 20) / 8);
+
+    auto report = [](char const * name, auto elapsed)
+            {
+                auto elapsedInSec = std::chrono::duration<double>(elapsed).count();
+                std::cout << "\t" << name << ": " << (megabytesProcessed / elapsedInSec) << " MB/sec" << std::endl;
+            };
+
+    volatile std::int64_t runtimeWidth = N; // defeat constant propagation of the runtime path
+    for (auto compileTime : {false, true, false, true}) // run each twice - first run includes warm up
+    {
+        std::deque<push_stream::packet_type> output;
+        auto codeSize = runtimeWidth;
+        auto mask = (N == 64) ? ~0ull : ((1ull << N) - 1);
+        auto start = std::chrono::steady_clock::now();
+        {
+            push_stream pushStream({.bufferOutputHandler_ = [&](auto packet){output.emplace_back(std::move(packet));}});
+            if (compileTime)
+                for (auto i = 0ull; i < num_codes; ++i)
+                    pushStream.push<N>(i & mask);
+            else
+                for (auto i = 0ull; i < num_codes; ++i)
+                    pushStream.push(i & mask, codeSize);
+        }
+        report(compileTime ? "push<N>" : "push   ", std::chrono::steady_clock::now() - start);
+
+        pop_stream popStream({[&](){auto ret = std::move(output.front()); output.pop_front(); return ret;}});
+        auto sum = 0ull;
+        start = std::chrono::steady_clock::now();
+        if (compileTime)
+            for (auto i = 0ull; i < num_codes; ++i)
+                sum += popStream.pop<N>();
+        else
+            for (auto i = 0ull; i < num_codes; ++i)
+                sum += popStream.pop(codeSize);
+        report(compileTime ? "pop<N> " : "pop    ", std::chrono::steady_clock::now() - start);
+        if (sum != [&](){auto total = 0ull; for (auto i = 0ull; i < num_codes; ++i) total += (i & mask); return total;}())
+            std::cout << "\tvalidation failed" << std::endl;
+    }
+}
+
+
+//=============================================================================
+template <std::size_t N>
+void multi_lane_benchmark
+(
+    // compare a single stream against N interleaved lanes
+)
+{
+    using namespace maniscalco;
+    static auto constexpr num_codes = (1ull << 24);
+    static auto constexpr code_size = 13;
+    static auto constexpr megabytesProcessed = (((double)num_codes * code_size) / (1 << 20) / 8);
+
+    auto report = [](char const * name, auto elapsed)
+            {
+                auto elapsedInSec = std::chrono::duration<double>(elapsed).count();
+                std::cout << "\t" << name << ": " << (megabytesProcessed / elapsedInSec) << " MB/sec" << std::endl;
+            };
+
+    std::vector<std::uint64_t> codes(num_codes);
+    for (auto i = 0ull; i < num_codes; ++i)
+        codes[i] = ((i * 0x9e3779b97f4a7c15ull) >> (64 - code_size));
+    std::vector<std::uint64_t> decoded(num_codes);
+
+    for (auto multiLane : {false, true, false, true}) // run each twice - first run includes warm up
+    {
+        std::deque<push_stream::packet_type> output;
+        auto start = std::chrono::steady_clock::now();
+        if (multiLane)
+        {
+            io::multi_lane_push_stream<push_stream_direction, N> pushStream({.bufferOutputHandler_ = [&](auto packet){output.emplace_back(std::move(packet));}});
+            pushStream.push_n(codes, code_size);
+        }
+        else
+        {
+            push_stream pushStream({.bufferOutputHandler_ = [&](auto packet){output.emplace_back(std::move(packet));}});
+            for (auto code : codes)
+                pushStream.push(code, code_size);
+        }
+        report(multiLane ? "push lanes " : "push single", std::chrono::steady_clock::now() - start);
+
+        auto inputHandler = [&]()
+                {
+                    if (output.empty())
+                        return push_stream::packet_type{};
+                    auto ret = std::move(output.front()); 
+                    output.pop_front(); 
+                    return ret;
+                };
+        start = std::chrono::steady_clock::now();
+        if (multiLane)
+        {
+            io::multi_lane_pop_stream<pop_stream_direction, N> popStream({inputHandler});
+            popStream.pop_n(decoded, code_size);
+        }
+        else
+        {
+            pop_stream popStream({inputHandler});
+            for (auto & code : decoded)
+                code = popStream.pop(code_size);
+        }
+        report(multiLane ? "pop lanes  " : "pop single ", std::chrono::steady_clock::now() - start);
+        if (decoded != codes)
+            std::cout << "\tvalidation failed" << std::endl;
+    }
+}
+
+
 //=============================================================================
 int main
 (
@@ -195,6 +372,10 @@ int main
     std::cout << "Memory stream test - custom 1MB buffer size:" << std::endl;
     benchmark_test(&memory_stream_test, [](){return maniscalco::buffer((1 << 20) * 8);});
 
+    // demonstrate memory stream with recycled buffers
+    std::cout << "Memory stream test - buffer pool:" << std::endl;
+    benchmark_test(&memory_stream_test, maniscalco::buffer_pool({.bufferSize_ = push_stream::default_buffer_size}));
+
     // demonstrate basic file stream
     std::cout << "File stream test - default buffer size:" << std::endl;
     benchmark_test(&file_stream_test);
@@ -203,6 +384,14 @@ int main
     std::cout << "File stream test - custom 1MB buffer size:" << std::endl;
     benchmark_test(&file_stream_test, [](){return maniscalco::buffer((1 << 20) * 8);});
 
+    // demonstrate memory mapped file stream
+    std::cout << "Memory mapped file stream test - default buffer size:" << std::endl;
+    benchmark_test(&mmap_file_stream_test);
+
+    // demonstrate asynchronous output to memory mapped file
+    std::cout << "Memory mapped file stream test - async output:" << std::endl;
+    benchmark_test(&async_mmap_file_stream_test);
+
     // demonstate custom buffer allocator - in this case using file stream
     std::cout << "File stream test - buffer w/ custom alloaction:" << std::endl;
     benchmark_test(&file_stream_test, 
@@ -214,5 +403,23 @@ int main
             return buffer;
         });
 
+    // compare runtime code size with compile time code size
+    std::cout << "Code width benchmark - 8 bits:" << std::endl;
+    code_width_benchmark<8>();
+    std::cout << "Code width benchmark - 13 bits:" << std::endl;
+    code_width_benchmark<13>();
+    std::cout << "Code width benchmark - 32 bits:" << std::endl;
+    code_width_benchmark<32>();
+    std::cout << "Code width benchmark - 64 bits:" << std::endl;
+    code_width_benchmark<64>();
+
+    // demonstrate interleaved multi lane streams
+    std::cout << "Multi lane benchmark - 2 lanes:" << std::endl;
+    multi_lane_benchmark<2>();
+    std::cout << "Multi lane benchmark - 4 lanes:" << std::endl;
+    multi_lane_benchmark<4>();
+    std::cout << "Multi lane benchmark - 8 lanes:" << std::endl;
+    multi_lane_benchmark<8>();
+
     return 0;
 }
@@ -1,4 +1,21 @@
 #pragma once
 
 #include "./io/push_stream.h"
-#include "./io/pop_stream.h"
\ No newline at end of file
+#include "./io/pop_stream.h"
+#include "./io/bit_reader.h"
+#include "./io/buffer_pool.h"
+#include "./io/huge_pages.h"
+#include "./io/packet_index.h"
+#include "./io/mmap_file.h"
+#include "./io/direct_file.h"
+#include "./io/container.h"
+#include "./io/async_output_handler.h"
+#include "./io/thread_pool.h"
+#include "./io/parallel_decode.h"
+#include "./io/packet_transform.h"
+#include "./io/packet_channel.h"
+#include "./io/multi_lane_stream.h"
+#include "./io/shared_memory.h"
+#include "./io/socket.h"
+#include "./io/huffman.h"
+#include "./io/universal_code.h"
\ No newline at end of file
@@ -0,0 +1,192 @@
+#include "./async_output_handler.h"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <algorithm>
+#include <utility>
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+class maniscalco::io::async_output_handler<S>::state final
+{
+public:
+
+    state
+    (
+        configuration_type const & configuration
+    ):
+        bufferOutputHandler_(configuration.bufferOutputHandler_),
+        flushHandler_(configuration.flushHandler_),
+        queueDepth_(std::max<size_type>(configuration.queueDepth_, 1)),
+        thread_([this](){run();})
+    {
+    }
+
+    ~state()
+    {
+        {
+            std::lock_guard lock(mutex_);
+            terminate_ = true;
+        }
+        notEmpty_.notify_one();
+        thread_.join();
+    }
+
+    void push
+    (
+        packet_type packet
+    )
+    {
+        std::unique_lock lock(mutex_);
+        notFull_.wait(lock, [&](){return ((queue_.size() < (std::size_t)queueDepth_) || (error_));});
+        rethrow_error();
+        queue_.emplace_back(std::move(packet));
+        lock.unlock();
+        notEmpty_.notify_one();
+    }
+
+    void flush()
+    {
+        std::unique_lock lock(mutex_);
+        auto ticket = ++flushRequested_;
+        notEmpty_.notify_one();
+        notFull_.wait(lock, [&](){return ((flushCompleted_ >= ticket) || (error_));});
+        rethrow_error();
+    }
+
+private:
+
+    void rethrow_error()
+    {
+        // sticky - packets were discarded so no later flush can succeed
+        if (error_)
+            std::rethrow_exception(error_);
+    }
+
+    void run()
+    {
+        std::unique_lock lock(mutex_);
+        while (true)
+        {
+            notEmpty_.wait(lock, [&](){return ((!queue_.empty()) || (flushRequested_ > flushCompleted_) || (terminate_));});
+            if (error_)
+            {
+                // handlers are not called again after an error
+                queue_.clear();
+                flushCompleted_ = flushRequested_;
+                notFull_.notify_all();
+                if (terminate_)
+                    return;
+                continue;
+            }
+            try
+            {
+                while (!queue_.empty())
+                {
+                    auto packet = std::move(queue_.front());
+                    queue_.pop_front();
+                    lock.unlock();
+                    notFull_.notify_one();
+                    bufferOutputHandler_(std::move(packet));
+                    lock.lock();
+                }
+                if (flushRequested_ > flushCompleted_)
+                {
+                    auto ticket = flushRequested_;
+                    if (flushHandler_)
+                    {
+                        lock.unlock();
+                        flushHandler_();
+                        lock.lock();
+                    }
+                    flushCompleted_ = ticket;
+                    notFull_.notify_all();
+                }
+            }
+            catch (...)
+            {
+                if (!lock.owns_lock())
+                    lock.lock();
+                error_ = std::current_exception();
+                queue_.clear();
+                notFull_.notify_all();
+            }
+            if ((terminate_) && (queue_.empty()))
+                return;
+        }
+    }
+
+    buffer_output_handler bufferOutputHandler_;
+
+    flush_handler flushHandler_;
+
+    size_type const queueDepth_;
+
+    std::mutex mutex_;
+
+    std::condition_variable notEmpty_;
+
+    std::condition_variable notFull_;
+
+    std::deque<packet_type> queue_;
+
+    std::uint64_t flushRequested_{0};
+
+    std::uint64_t flushCompleted_{0};
+
+    std::exception_ptr error_;
+
+    bool terminate_{false};
+
+    std::thread thread_;
+
+}; // class async_output_handler<S>::state
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+maniscalco::io::async_output_handler<S>::async_output_handler
+(
+    configuration_type const & configuration
+):
+    state_(std::make_shared<state>(configuration))
+{
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+void maniscalco::io::async_output_handler<S>::operator()
+(
+    // queue packet for output.  blocks if the queue is full.
+    packet_type packet
+)
+{
+    state_->push(std::move(packet));
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+void maniscalco::io::async_output_handler<S>::flush
+(
+    // blocks until all packets queued prior to this call have been written
+    // and the optional flush handler has completed.  rethrows any exception
+    // raised by the underlying handlers.
+)
+{
+    state_->flush();
+}
+
+
+//=============================================================================
+namespace maniscalco::io
+{
+    template class async_output_handler<stream_direction::forward>;
+    template class async_output_handler<stream_direction::reverse>;
+
+} // maniscalco
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "./stream_direction.h"
+#include "./stream_packet.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+
+namespace maniscalco::io
+{
+
+    // buffer output handler which hands packets to a background thread so that
+    // push_stream can continue encoding into its next buffer while previous
+    // buffers are being written.  when 'queueDepth_' packets are pending the 
+    // producer blocks (backpressure) until the writer catches up.
+    //
+    // an exception thrown by either handler on the writer thread is rethrown
+    // by every later call to operator() or flush().  packets still queued at
+    // that point are discarded so the stream is incomplete from then on.
+    template <stream_direction S>
+    class async_output_handler final
+    {
+    public:
+
+        using size_type = std::int64_t;
+        using packet_type = stream_packet<S>;
+        using buffer_output_handler = std::function<void(packet_type)>;
+        using flush_handler = std::function<void()>;
+
+        static size_type constexpr default_queue_depth = 4;
+
+        struct configuration_type 
+        {
+            buffer_output_handler bufferOutputHandler_;
+            // optional - invoked on the writer thread by flush() once all 
+            // pending packets are written (ex: fsync)
+            flush_handler flushHandler_;
+            size_type queueDepth_{default_queue_depth};
+        };
+
+        async_output_handler(configuration_type const &);
+
+        // copies share the same queue and writer thread
+        async_output_handler(async_output_handler const &) = default;
+        async_output_handler & operator = (async_output_handler const &) = default;
+
+        ~async_output_handler() = default;
+
+        void operator()
+        (
+            packet_type
+        );
+
+        void flush();
+
+    private:
+
+        class state;
+
+        std::shared_ptr<state> state_;
+
+    }; // class async_output_handler
+
+} // namespace maniscalco::io
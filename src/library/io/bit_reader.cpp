@@ -0,0 +1,161 @@
+#include "./bit_reader.h"
+
+#include <algorithm>
+#include <utility>
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+maniscalco::io::bit_reader<S>::bit_reader
+(
+    configuration_type const & configuration
+):
+    inputHandler_(configuration.inputHandler_)
+{
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+void maniscalco::io::bit_reader<S>::update_refill_limit
+(
+)
+{
+    if ((readPosition_ & 0x07) != 0)
+        refillLimit_ = fast_refill_disabled;
+    else if constexpr (S == stream_direction::forward)
+        refillLimit_ = (endCurrentBuffer_ - 64);
+    else
+        refillLimit_ = (endCurrentBuffer_ + 64);
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+bool maniscalco::io::bit_reader<S>::load_input_buffer
+(
+    // advance to the next packet.  returns false at the end of the stream.
+)
+{
+    if (endOfStream_)
+        return false;
+    if constexpr (S == stream_direction::forward)
+        sizeConsumed_ += (readPosition_ - beginCurrentBuffer_);
+    else
+        sizeConsumed_ += (beginCurrentBuffer_ - readPosition_);
+    packet_type packet = inputHandler_();
+    if (packet.size() == 0)
+    {
+        endOfStream_ = true;
+        buffer_ = {};
+        readPosition_ = beginCurrentBuffer_ = endCurrentBuffer_ = 0;
+        refillLimit_ = fast_refill_disabled;
+        return false;
+    }
+    buffer_ = std::move(packet.buffer_);
+    endCurrentBuffer_ = packet.endOffset_;
+    readPosition_ = beginCurrentBuffer_ = packet.startOffset_;
+    update_refill_limit();
+    return true;
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+void maniscalco::io::bit_reader<S>::refill_slow
+(
+    // the current packet has fewer than 64 bits remaining (or the read
+    // position is not byte aligned).  load what remains one byte at a time
+    // and continue into the next packet(s) as required.  stopping below 64
+    // bits means a whole byte always fits so the read position stays byte
+    // aligned (unless a packet ends mid byte).
+)
+{
+    // bits beyond bitCount_ left by the fast path belong to the current
+    // packet and must not be combined with bits of the next packet
+    if constexpr (S == stream_direction::forward)
+        bitContainer_ = (bitCount_ > 0) ? (bitContainer_ & (~0ull << (64 - bitCount_))) : 0;
+    else
+        bitContainer_ = (bitCount_ > 0) ? (bitContainer_ & (~0ull >> (64 - bitCount_))) : 0;
+
+    while (bitCount_ < max_peek_size)
+    {
+        if constexpr (S == stream_direction::forward)
+        {
+            auto available = (endCurrentBuffer_ - readPosition_);
+            if (available <= 0)
+            {
+                if (!load_input_buffer())
+                    return;
+                continue;
+            }
+            auto offset = (readPosition_ & 0x07);
+            auto chunk = std::min({(size_type)(bits_per_byte - offset), available, (size_type)(63 - bitCount_)});
+            std::uint64_t bits = ((buffer_.data()[readPosition_ >> 3] >> (bits_per_byte - offset - chunk)) & ((1ull << chunk) - 1));
+            bitContainer_ |= (bits << (64 - bitCount_ - chunk));
+            readPosition_ += chunk;
+            bitCount_ += chunk;
+        }
+        else
+        {
+            auto available = (readPosition_ - endCurrentBuffer_);
+            if (available <= 0)
+            {
+                if (!load_input_buffer())
+                    return;
+                continue;
+            }
+            // the bits [readPosition_ - chunk, readPosition_) all lie within one byte
+            auto offset = ((readPosition_ - 1) & 0x07);
+            auto chunk = std::min({(size_type)(offset + 1), available, (size_type)(63 - bitCount_)});
+            std::uint64_t bits = ((buffer_.data()[(readPosition_ - 1) >> 3] >> (7 - offset)) & ((1ull << chunk) - 1));
+            bitContainer_ |= (bits << bitCount_);
+            readPosition_ -= chunk;
+            bitCount_ += chunk;
+        }
+    }
+    update_refill_limit();
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+void maniscalco::io::bit_reader<S>::skip
+(
+    // discard the contents of the container and then 'count' further bits
+    // without loading them
+    size_type count
+)
+{
+    bitContainer_ = 0;
+    bitCount_ = 0;
+    while (count > 0)
+    {
+        if constexpr (S == stream_direction::forward)
+        {
+            auto available = std::min(endCurrentBuffer_ - readPosition_, count);
+            readPosition_ += available;
+            count -= available;
+            if ((readPosition_ == endCurrentBuffer_) && (count > 0) && (!load_input_buffer()))
+                return;
+        }
+        else
+        {
+            auto available = std::min(readPosition_ - endCurrentBuffer_, count);
+            readPosition_ -= available;
+            count -= available;
+            if ((readPosition_ == endCurrentBuffer_) && (count > 0) && (!load_input_buffer()))
+                return;
+        }
+    }
+    update_refill_limit();
+}
+
+
+//=============================================================================
+namespace maniscalco::io
+{
+    template class bit_reader<stream_direction::forward>;
+    template class bit_reader<stream_direction::reverse>;
+
+} // maniscalco
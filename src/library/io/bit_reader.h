@@ -0,0 +1,417 @@
+#pragma once
+
+#include "./buffer.h"
+#include "./stream_direction.h"
+#include "./stream_packet.h"
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <tuple>
+
+
+namespace maniscalco::io
+{
+
+    // alternative to pop_stream which keeps the next bits of the stream in a
+    // 64 bit container.  the container is refilled with a single unaligned
+    // load every ~56 bits and the end of the packet is only tested on refill
+    // so pop and peek are a shift and a mask.  reads the same packets as
+    // pop_stream and yields the same codes.
+    //
+    // the gain is in decoding where the size of each code depends on the bits
+    // peeked (see decode_n).  where code sizes are known in advance each
+    // pop_stream::pop is independent of the last and pop_stream is faster.
+    //
+    // forward: the next bit is the msb of the container.
+    // reverse: the next bit is the lsb of the container.
+    //
+    // peek and pop of up to 'max_peek_size' bits never require more than one
+    // refill.  past the end of the stream missing bits are returned as zero.
+    // the reader never reads outside of the bits of a packet.
+    template <stream_direction S>
+    class bit_reader final
+    {
+    public:
+
+        static auto constexpr bits_per_byte = 8;
+
+        using code_type = std::uint64_t;
+        using size_type = std::int64_t;
+        using packet_type = stream_packet<S>;
+        using input_handler = std::function<packet_type()>;
+
+        static size_type constexpr max_peek_size = 56;
+
+        struct configuration_type
+        {
+            input_handler inputHandler_;
+        };
+
+        bit_reader() = default;
+
+        bit_reader(configuration_type const &);
+
+        bit_reader(bit_reader &&) = default;
+        bit_reader & operator = (bit_reader &&) = default;
+
+        bit_reader(bit_reader const &) = delete;
+        bit_reader & operator = (bit_reader const &) = delete;
+
+        ~bit_reader() = default;
+
+        // 0 < codeSize <= 64
+        code_type pop
+        (
+            size_type
+        );
+
+        template <size_type N>
+        code_type pop();
+
+        code_type pop_bit();
+
+        // 0 < codeSize <= max_peek_size
+        code_type peek
+        (
+            size_type
+        );
+
+        void discard
+        (
+            size_type
+        );
+
+        // decodes 'count' codes.  for each code 'decoder' is passed the next
+        // max_peek_size bits (as returned by peek(max_peek_size)) and returns 
+        // the number of those bits which it consumed.  the container is kept 
+        // in registers for the duration of the call which is not possible 
+        // across separate calls to pop.
+        template <typename F>
+        void decode_n
+        (
+            size_type,
+            F &&
+        );
+
+        void align();
+
+        size_type size_consumed() const;
+
+    private:
+
+        static size_type constexpr fast_refill_disabled = (S == stream_direction::forward) ? -1 : 
+                std::numeric_limits<size_type>::max();
+
+        void refill();
+
+        void refill_slow();
+
+        void update_refill_limit();
+
+        void skip
+        (
+            size_type
+        );
+
+        bool load_input_buffer();
+
+        code_type take
+        (
+            size_type
+        );
+
+        input_handler inputHandler_;
+
+        buffer buffer_;
+
+        // bits of the current packet are [beginCurrentBuffer_, endCurrentBuffer_)
+        // for forward packets and [endCurrentBuffer_, beginCurrentBuffer_) for
+        // reverse packets.  readPosition_ is the next bit to load into the container.
+        size_type beginCurrentBuffer_{0};
+
+        size_type endCurrentBuffer_{0};
+
+        size_type readPosition_{0};
+
+        // the fast refill is used while the read position is byte aligned and
+        // at least 64 bits from the end of the packet.  the limit folds both
+        // tests into one comparison.
+        size_type refillLimit_{fast_refill_disabled};
+
+        size_type sizeConsumed_{0};
+
+        std::uint64_t bitContainer_{0};
+
+        // never more than 63 so that shifting by bitCount_ is always defined
+        size_type bitCount_{0};
+
+        bool endOfStream_{false};
+
+    }; // class bit_reader
+
+    using forward_bit_reader = bit_reader<stream_direction::forward>;
+    using reverse_bit_reader = bit_reader<stream_direction::reverse>;
+
+} // namespace maniscalco::io
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+inline void maniscalco::io::bit_reader<S>::refill
+(
+    // ensure that the container holds at least max_peek_size bits unless
+    // the end of the stream has been reached
+)
+{
+    // load whole bytes until the container holds 56 to 63 bits.  bits beyond
+    // bitCount_ are the continuation of the stream so or-ing the same bits
+    // into the same place again is harmless.
+    if constexpr (S == stream_direction::forward)
+    {
+        if (readPosition_ <= refillLimit_)
+        {
+            std::uint64_t word;
+            std::memcpy(&word, buffer_.data() + (readPosition_ >> 3), sizeof(word));
+            bitContainer_ |= (endian_swap<std::endian::big, std::endian::native>(word) >> bitCount_);
+            readPosition_ += ((63 - bitCount_) & ~0x07);
+            bitCount_ |= 56;
+            return;
+        }
+    }
+    else
+    {
+        if (readPosition_ >= refillLimit_)
+        {
+            std::uint64_t word;
+            std::memcpy(&word, buffer_.data() + (readPosition_ >> 3) - sizeof(word), sizeof(word));
+            bitContainer_ |= (endian_swap<std::endian::big, std::endian::native>(word) << bitCount_);
+            readPosition_ -= ((63 - bitCount_) & ~0x07);
+            bitCount_ |= 56;
+            return;
+        }
+    }
+    refill_slow();
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+inline auto maniscalco::io::bit_reader<S>::take
+(
+    // remove and return the next 'codeSize' bits.  0 < codeSize <= max_peek_size.
+    // refilling unconditionally is cheaper than a test on the code size which
+    // is mispredicted whenever code sizes vary.
+    size_type codeSize
+) -> code_type
+{
+    refill();
+    code_type code;
+    if constexpr (S == stream_direction::forward)
+    {
+        code = (bitContainer_ >> (64 - codeSize));
+        bitContainer_ <<= codeSize;
+    }
+    else
+    {
+        code = (bitContainer_ & ((1ull << codeSize) - 1));
+        bitContainer_ >>= codeSize;
+    }
+    bitCount_ -= codeSize;
+    return code;
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+inline auto maniscalco::io::bit_reader<S>::pop
+(
+    size_type codeSize
+) -> code_type
+{
+    if (codeSize <= max_peek_size)
+        return take(codeSize);
+    // after a refill the container holds 56 to 63 bits so wide codes usually
+    // fit.  otherwise they are taken in two parts.
+    refill();
+    if (codeSize <= bitCount_)
+    {
+        code_type code;
+        if constexpr (S == stream_direction::forward)
+        {
+            code = (bitContainer_ >> (64 - codeSize));
+            bitContainer_ = ((bitContainer_ << (codeSize - 1)) << 1);
+        }
+        else
+        {
+            code = (bitContainer_ & (~0ull >> (64 - codeSize)));
+            bitContainer_ = ((bitContainer_ >> (codeSize - 1)) >> 1);
+        }
+        bitCount_ -= codeSize;
+        return code;
+    }
+    if constexpr (S == stream_direction::forward)
+    {
+        auto high = take(codeSize - 32);
+        return ((high << 32) | take(32));
+    }
+    else
+    {
+        auto low = take(32);
+        return (low | (take(codeSize - 32) << 32));
+    }
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+template <typename maniscalco::io::bit_reader<S>::size_type N>
+inline auto maniscalco::io::bit_reader<S>::pop
+(
+    // code size known at compile time
+) -> code_type
+{
+    static_assert((N > 0) && (N <= 64), "bit_reader: code size must be in the range [1, 64]");
+    if constexpr (N <= max_peek_size)
+        return take(N);
+    else
+        return pop(N);
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+inline auto maniscalco::io::bit_reader<S>::pop_bit
+(
+) -> code_type
+{
+    return take(1);
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+inline auto maniscalco::io::bit_reader<S>::peek
+(
+    size_type codeSize
+) -> code_type
+{
+    refill();
+    if constexpr (S == stream_direction::forward)
+        return (bitContainer_ >> (64 - codeSize));
+    else
+        return (bitContainer_ & ((1ull << codeSize) - 1));
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+inline void maniscalco::io::bit_reader<S>::discard
+(
+    size_type count
+)
+{
+    if (count <= bitCount_)
+    {
+        if constexpr (S == stream_direction::forward)
+            bitContainer_ <<= count;
+        else
+            bitContainer_ >>= count;
+        bitCount_ -= count;
+        return;
+    }
+    skip(count - bitCount_);
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+template <typename F>
+inline void maniscalco::io::bit_reader<S>::decode_n
+(
+    size_type count,
+    F && decoder
+)
+{
+    auto bitContainer = bitContainer_;
+    auto bitCount = bitCount_;
+    auto readPosition = readPosition_;
+    auto refillLimit = refillLimit_;
+    auto data = buffer_.data();
+    for (; count > 0; --count)
+    {
+        code_type window;
+        if constexpr (S == stream_direction::forward)
+        {
+            if (readPosition <= refillLimit)
+            {
+                std::uint64_t word;
+                std::memcpy(&word, data + (readPosition >> 3), sizeof(word));
+                bitContainer |= (endian_swap<std::endian::big, std::endian::native>(word) >> bitCount);
+                readPosition += ((63 - bitCount) & ~0x07);
+                bitCount |= 56;
+            }
+            else
+            {
+                std::tie(bitContainer_, bitCount_, readPosition_) = std::tie(bitContainer, bitCount, readPosition);
+                refill_slow();
+                std::tie(bitContainer, bitCount, readPosition, refillLimit) = std::tie(bitContainer_, bitCount_, readPosition_, refillLimit_);
+                data = buffer_.data();
+            }
+            window = (bitContainer >> (64 - max_peek_size));
+            auto n = (size_type)decoder(window);
+            bitContainer <<= n;
+            bitCount -= n;
+        }
+        else
+        {
+            if (readPosition >= refillLimit)
+            {
+                std::uint64_t word;
+                std::memcpy(&word, data + (readPosition >> 3) - sizeof(word), sizeof(word));
+                bitContainer |= (endian_swap<std::endian::big, std::endian::native>(word) << bitCount);
+                readPosition -= ((63 - bitCount) & ~0x07);
+                bitCount |= 56;
+            }
+            else
+            {
+                std::tie(bitContainer_, bitCount_, readPosition_) = std::tie(bitContainer, bitCount, readPosition);
+                refill_slow();
+                std::tie(bitContainer, bitCount, readPosition, refillLimit) = std::tie(bitContainer_, bitCount_, readPosition_, refillLimit_);
+                data = buffer_.data();
+            }
+            window = (bitContainer & ((1ull << max_peek_size) - 1));
+            auto n = (size_type)decoder(window);
+            bitContainer >>= n;
+            bitCount -= n;
+        }
+    }
+    std::tie(bitContainer_, bitCount_, readPosition_) = std::tie(bitContainer, bitCount, readPosition);
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+inline void maniscalco::io::bit_reader<S>::align
+(
+    // discard bits until at the next byte boundary
+)
+{
+    if (auto n = ((bits_per_byte - (size_consumed() & 0x07)) & 0x07); n > 0)
+        take(n);
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+inline auto maniscalco::io::bit_reader<S>::size_consumed
+(
+    // returns the number of bits consumed thus far
+) const -> size_type
+{
+    if constexpr (S == stream_direction::forward)
+        return (sizeConsumed_ + (readPosition_ - beginCurrentBuffer_) - bitCount_);
+    else
+        return (sizeConsumed_ + (beginCurrentBuffer_ - readPosition_) - bitCount_);
+}
@@ -1,15 +1,21 @@
 #include "./buffer.h"
 
+#include <cstring>
+#include <utility>
+
 
 //=============================================================================
 maniscalco::buffer::buffer
 (
-    // allocate using specified capacity
+    // allocate using specified capacity plus slack before and after
     size_type capacity
 ): 
     capacity_(capacity), 
-    data_(new std::uint8_t[capacity_], [](auto p){delete [] p;})
+    slack_(slack_size),
+    data_(new std::uint8_t[capacity_ + (2 * slack_size)] + slack_size, [](auto p){delete [] (p - slack_size);})
 {
+    std::memset(data_.get() - slack_size, 0x00, slack_size);
+    std::memset(data_.get() + capacity_, 0x00, slack_size);
 }
 
 
@@ -18,11 +24,14 @@ maniscalco::buffer::buffer
 (
     // seat over memory provided
     // optional deleter hook
+    // optional slack (see slack_size)
     element_type * data, 
     size_type capacity, 
-    std::function<void(element_type *)> deleter
+    std::function<void(element_type *)> deleter,
+    size_type slack
 ): 
     capacity_(capacity), 
+    slack_(slack),
     data_(data, deleter)
 {
 }
@@ -34,6 +43,7 @@ maniscalco::buffer::buffer
     buffer && other
 ): 
     capacity_(other.capacity_), 
+    slack_(std::exchange(other.slack_, 0)),
     data_(std::move(other.data_))
 {
     other.capacity_ = 0;
@@ -48,6 +58,7 @@ auto maniscalco::buffer::operator =
 ) -> buffer &
 {
     capacity_ = other.capacity_;
+    slack_ = std::exchange(other.slack_, 0);
     data_ = std::move(other.data_);
     other.data_ = nullptr;
     other.capacity_ = 0;
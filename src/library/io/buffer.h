@@ -19,9 +19,18 @@ namespace maniscalco
         using iterator = element_type *;
         using const_iterator = element_type const *;
 
+        // buffers allocated by buffer(size_type) (and by buffer_pool) are 
+        // surrounded by slack_size bytes of memory before begin() and after 
+        // end().  readers may load whole words which extend into the slack and
+        // may write into it so its contents are unspecified (it is zeroed when
+        // allocated but buffer_pool recycles buffers without clearing it).
+        // buffers seated over memory provided have whatever slack the 
+        // provider specifies (none by default).
+        static size_type constexpr slack_size = 32;
+
         buffer() = default;
 
-        buffer(iterator, size_type, std::function<void(element_type *)> = nullptr);
+        buffer(iterator, size_type, std::function<void(element_type *)> = nullptr, size_type = 0);
 
         buffer(size_type);
 
@@ -36,6 +45,9 @@ namespace maniscalco
 
         size_type capacity() const;
 
+        // bytes available both before begin() and after end()
+        size_type slack() const;
+
         iterator begin() const;
 
         iterator end() const;
@@ -50,6 +62,8 @@ namespace maniscalco
 
         size_type capacity_{0};
 
+        size_type slack_{0};
+
         std::unique_ptr<element_type [], std::function<void (element_type *)>> data_;
 
     }; // class buffer
@@ -66,6 +80,15 @@ inline maniscalco::buffer::operator bool
 }
 
 
+//=============================================================================
+inline auto maniscalco::buffer::slack
+(
+) const -> size_type
+{
+    return slack_;
+}
+
+
 //=============================================================================
 inline auto maniscalco::buffer::begin
 (
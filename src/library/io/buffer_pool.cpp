@@ -0,0 +1,186 @@
+#include "./buffer_pool.h"
+
+#include <algorithm>
+#include <bit>
+
+
+namespace
+{
+
+    using size_type = maniscalco::buffer_pool::size_type;
+
+
+    //=========================================================================
+    size_type usable_buffer_size
+    (
+        // huge page buffers keep their slack within the pages which the 
+        // requested size is rounded up to.  where the padding at the end of
+        // the last page is too small to hold it the buffer is made smaller 
+        // rather than mapping another page.
+        maniscalco::buffer_pool::configuration_type const & configuration
+    )
+    {
+        auto size = configuration.bufferSize_;
+        if (!configuration.hugePages_)
+            return size;
+        auto mappedSize = maniscalco::huge_pages::mapped_size(std::max<size_type>(size, 1));
+        return std::min(size, mappedSize - (2 * maniscalco::buffer::slack_size));
+    }
+
+} // namespace
+
+
+//=============================================================================
+maniscalco::buffer_pool::state::state
+(
+    configuration_type const & configuration
+):
+    bufferSize_(usable_buffer_size(configuration)),
+    hugePages_(configuration.hugePages_),
+    numaNode_(configuration.numaNode_),
+    prefault_(configuration.prefault_),
+    mask_(std::bit_ceil((std::size_t)std::max<size_type>(configuration.capacity_, 2)) - 1),
+    cells_(new cell_type[mask_ + 1])
+{
+    for (auto i = 0ull; i <= mask_; ++i)
+        cells_[i].sequence_.store(i, std::memory_order_relaxed);
+    // optionally pre-populate (and pre-fault) buffers
+    for (auto i = 0; i < configuration.initialCount_; ++i)
+        release(allocate_block(true));
+}
+
+
+//=============================================================================
+maniscalco::buffer_pool::state::~state
+(
+)
+{
+    while (auto p = try_pop())
+        free_block(p);
+}
+
+
+//=============================================================================
+auto maniscalco::buffer_pool::state::allocate_block
+(
+    // returns a new buffer with buffer::slack_size bytes of zeroed slack on
+    // either side (released buffers are recycled as is).  'prefault' touches
+    // every byte of it.
+    bool prefault
+) -> element_type *
+{
+    auto size = (bufferSize_ + (2 * buffer::slack_size));
+    if (hugePages_)
+        return (huge_pages::allocate(size, numaNode_, prefault) + buffer::slack_size); // zero filled
+    auto p = new element_type[size];
+    if (prefault)
+    {
+        std::fill(p, p + size, 0x00);
+    }
+    else
+    {
+        std::fill(p, p + buffer::slack_size, 0x00);
+        std::fill(p + buffer::slack_size + bufferSize_, p + size, 0x00);
+    }
+    return (p + buffer::slack_size);
+}
+
+
+//=============================================================================
+void maniscalco::buffer_pool::state::free_block
+(
+    element_type * p
+)
+{
+    if (hugePages_)
+        huge_pages::deallocate(p - buffer::slack_size, bufferSize_ + (2 * buffer::slack_size));
+    else
+        delete [] (p - buffer::slack_size);
+}
+
+
+//=============================================================================
+maniscalco::buffer_pool::buffer_pool
+(
+):
+    buffer_pool(configuration_type{})
+{
+}
+
+
+//=============================================================================
+maniscalco::buffer_pool::buffer_pool
+(
+    configuration_type const & configuration
+):
+    state_(new state(configuration))
+{
+}
+
+
+//=============================================================================
+maniscalco::buffer_pool::buffer_pool
+(
+    buffer_pool const & other
+):
+    state_(other.state_)
+{
+    if (state_ != nullptr)
+        state_->add_reference();
+}
+
+
+//=============================================================================
+auto maniscalco::buffer_pool::operator =
+(
+    buffer_pool const & other
+) -> buffer_pool &
+{
+    if (this != &other)
+    {
+        if (other.state_ != nullptr)
+            other.state_->add_reference();
+        if (state_ != nullptr)
+            state_->remove_reference();
+        state_ = other.state_;
+    }
+    return *this;
+}
+
+
+//=============================================================================
+maniscalco::buffer_pool::buffer_pool
+(
+    buffer_pool && other
+):
+    state_(other.state_)
+{
+    other.state_ = nullptr;
+}
+
+
+//=============================================================================
+auto maniscalco::buffer_pool::operator =
+(
+    buffer_pool && other
+) -> buffer_pool &
+{
+    if (this != &other)
+    {
+        if (state_ != nullptr)
+            state_->remove_reference();
+        state_ = other.state_;
+        other.state_ = nullptr;
+    }
+    return *this;
+}
+
+
+//=============================================================================
+maniscalco::buffer_pool::~buffer_pool
+(
+)
+{
+    if (state_ != nullptr)
+        state_->remove_reference();
+}
@@ -0,0 +1,287 @@
+#pragma once
+
+#include "./buffer.h"
+#include "./huge_pages.h"
+
+#include <cstdint>
+#include <algorithm>
+#include <cstddef>
+#include <atomic>
+#include <memory>
+
+
+namespace maniscalco
+{
+
+    class buffer_pool final 
+    {
+    public:
+
+        using size_type = buffer::size_type;
+        using element_type = buffer::element_type;
+
+        static size_type constexpr default_buffer_size = ((1 << 10) * 8);
+        static size_type constexpr default_capacity = 64;
+
+        struct configuration_type 
+        {
+            size_type bufferSize_{default_buffer_size};
+            size_type capacity_{default_capacity};
+            size_type initialCount_{0};
+            // allocate each buffer (and its slack) from 2MB huge pages (see 
+            // huge_pages.h).  bufferSize_ is rounded up to a whole number of
+            // pages and the slack is kept within them so buffers which would
+            // not leave room for it are reduced by 2 * buffer::slack_size 
+            // (see buffer_size()).  intended for buffers of 1MB and more.
+            bool hugePages_{false};
+            // node for huge page buffers.  huge_pages::local_node is the node
+            // of the thread which allocates the buffer.
+            std::int32_t numaNode_{huge_pages::local_node};
+            // touch every page of a buffer when it is allocated rather than 
+            // when the buffer is first written
+            bool prefault_{false};
+        };
+
+        buffer_pool();
+
+        buffer_pool(configuration_type const &);
+
+        buffer_pool(buffer_pool const &);
+
+        buffer_pool & operator = (buffer_pool const &);
+
+        buffer_pool(buffer_pool &&);
+
+        buffer_pool & operator = (buffer_pool &&);
+
+        ~buffer_pool();
+
+        buffer allocate();
+
+        buffer operator()();
+
+        // capacity of the buffers allocated (less than bufferSize_ where 
+        // huge pages could not hold both it and the slack)
+        size_type buffer_size() const;
+
+    private:
+
+        class state;
+
+        state * state_{nullptr};
+
+    }; // class buffer_pool
+
+
+    class buffer_pool::state final
+    {
+    public:
+
+        state(configuration_type const &);
+
+        ~state();
+
+        element_type * acquire();
+
+        void release(element_type *);
+
+        void add_reference();
+
+        void remove_reference();
+
+        size_type buffer_size() const;
+
+    private:
+
+        static auto constexpr cache_line_size = 64;
+
+        // bounded multi-producer/multi-consumer free list (Vyukov)
+        struct cell_type
+        {
+            std::atomic<std::size_t> sequence_;
+            element_type * data_;
+        };
+
+        bool try_push(element_type *);
+
+        element_type * try_pop();
+
+        element_type * allocate_block
+        (
+            bool
+        );
+
+        void free_block
+        (
+            element_type *
+        );
+
+        size_type const bufferSize_;
+
+        bool const hugePages_;
+
+        std::int32_t const numaNode_;
+
+        bool const prefault_;
+
+        std::size_t const mask_;
+
+        std::unique_ptr<cell_type []> cells_;
+
+        alignas(cache_line_size) std::atomic<std::size_t> enqueuePosition_{0};
+
+        alignas(cache_line_size) std::atomic<std::size_t> dequeuePosition_{0};
+
+        alignas(cache_line_size) std::atomic<std::int64_t> referenceCount_{1};
+
+    }; // class buffer_pool::state
+
+} // namespace maniscalco
+
+
+//=============================================================================
+inline auto maniscalco::buffer_pool::allocate
+(
+    // returns a buffer which will return itself to this pool upon destruction
+) -> buffer
+{
+    state_->add_reference();
+    return buffer(state_->acquire(), state_->buffer_size(), 
+            [s = state_](auto * p){s->release(p); s->remove_reference();}, buffer::slack_size);
+}
+
+
+//=============================================================================
+inline auto maniscalco::buffer_pool::operator()
+(
+    // allows the pool to be used directly as a buffer_allocation_handler
+) -> buffer
+{
+    return allocate();
+}
+
+
+//=============================================================================
+inline auto maniscalco::buffer_pool::buffer_size
+(
+) const -> size_type
+{
+    return state_->buffer_size();
+}
+
+
+//=============================================================================
+inline auto maniscalco::buffer_pool::state::buffer_size
+(
+) const -> size_type
+{
+    return bufferSize_;
+}
+
+
+//=============================================================================
+inline void maniscalco::buffer_pool::state::add_reference
+(
+)
+{
+    referenceCount_.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+//=============================================================================
+inline void maniscalco::buffer_pool::state::remove_reference
+(
+    // state is destroyed once the last pool handle and the last 
+    // outstanding buffer have both been released
+)
+{
+    if (referenceCount_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        delete this;
+}
+
+
+//=============================================================================
+inline auto maniscalco::buffer_pool::state::acquire
+(
+) -> element_type *
+{
+    if (auto p = try_pop(); p != nullptr)
+        return p;
+    return allocate_block(prefault_);
+}
+
+
+//=============================================================================
+inline void maniscalco::buffer_pool::state::release
+(
+    element_type * p
+)
+{
+    if (!try_push(p))
+        free_block(p); // free list is full
+}
+
+
+//=============================================================================
+inline bool maniscalco::buffer_pool::state::try_push
+(
+    element_type * p
+)
+{
+    auto position = enqueuePosition_.load(std::memory_order_relaxed);
+    while (true)
+    {
+        auto & cell = cells_[position & mask_];
+        auto sequence = cell.sequence_.load(std::memory_order_acquire);
+        auto diff = (std::intptr_t)sequence - (std::intptr_t)position;
+        if (diff == 0)
+        {
+            if (enqueuePosition_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+            {
+                cell.data_ = p;
+                cell.sequence_.store(position + 1, std::memory_order_release);
+                return true;
+            }
+        }
+        else if (diff < 0)
+        {
+            return false;
+        }
+        else
+        {
+            position = enqueuePosition_.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+
+//=============================================================================
+inline auto maniscalco::buffer_pool::state::try_pop
+(
+) -> element_type *
+{
+    auto position = dequeuePosition_.load(std::memory_order_relaxed);
+    while (true)
+    {
+        auto & cell = cells_[position & mask_];
+        auto sequence = cell.sequence_.load(std::memory_order_acquire);
+        auto diff = (std::intptr_t)sequence - (std::intptr_t)(position + 1);
+        if (diff == 0)
+        {
+            if (dequeuePosition_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+            {
+                auto p = cell.data_;
+                cell.sequence_.store(position + mask_ + 1, std::memory_order_release);
+                return p;
+            }
+        }
+        else if (diff < 0)
+        {
+            return nullptr;
+        }
+        else
+        {
+            position = dequeuePosition_.load(std::memory_order_relaxed);
+        }
+    }
+}
@@ -0,0 +1,783 @@
+#include "./container.h"
+#include "./crc32c.h"
+#include "./packet_record.h"
+#include "./buffer_pool.h"
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+#include <vector>
+#include <algorithm>
+#include <climits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+
+namespace
+{
+
+    using size_type = std::int64_t;
+    using maniscalco::io::container_header;
+
+    static std::uint64_t constexpr header_magic = 0x726e746e63747370ull; // "pstcntnr"
+    static std::uint32_t constexpr trailer_magic = 0x78646970;           // "pidx"
+    static std::uint32_t constexpr end_record_bits = 0xffffffff;
+    static std::uint8_t constexpr flag_indexed = 0x01;
+
+    static size_type constexpr header_size = 32;
+    static size_type constexpr record_header_size = 8;
+    static size_type constexpr trailer_size = 16;
+
+    using header_bytes = std::array<std::uint8_t, header_size>;
+    using record_header_bytes = std::array<std::uint8_t, record_header_size>;
+    using trailer_bytes = std::array<std::uint8_t, trailer_size>;
+
+    #ifdef IOV_MAX
+        static size_type constexpr max_iov = IOV_MAX;
+    #else
+        static size_type constexpr max_iov = 1024;
+    #endif
+
+
+    //=========================================================================
+    [[noreturn]] void throw_system_error
+    (
+        std::string const & what
+    )
+    {
+        throw std::system_error(errno, std::generic_category(), what);
+    }
+
+
+    //=========================================================================
+    template <typename T>
+    inline void store
+    (
+        std::uint8_t * destination,
+        T value
+    )
+    {
+        value = maniscalco::endian_swap<std::endian::native, std::endian::little>(value);
+        std::memcpy(destination, &value, sizeof(value));
+    }
+
+
+    //=========================================================================
+    template <typename T>
+    inline T load
+    (
+        std::uint8_t const * source
+    )
+    {
+        T value;
+        std::memcpy(&value, source, sizeof(value));
+        return maniscalco::endian_swap<std::endian::little, std::endian::native>(value);
+    }
+
+
+    //=========================================================================
+    header_bytes encode_header
+    (
+        container_header const & header
+    )
+    {
+        header_bytes bytes{};
+        store<std::uint64_t>(bytes.data(), header_magic);
+        store<std::uint16_t>(bytes.data() + 8, header.version_);
+        bytes[10] = (std::uint8_t)header.direction_;
+        bytes[11] = (header.indexed_ ? flag_indexed : 0);
+        store<std::uint32_t>(bytes.data() + 12, header.codec_);
+        store<std::uint64_t>(bytes.data() + 16, header.bufferSize_);
+        store<std::uint32_t>(bytes.data() + 28, maniscalco::io::crc32c(bytes.data(), 28));
+        return bytes;
+    }
+
+
+    //=========================================================================
+    container_header decode_header
+    (
+        header_bytes const & bytes
+    )
+    {
+        if (load<std::uint64_t>(bytes.data()) != header_magic)
+            throw std::runtime_error("container: not a container file");
+        if (load<std::uint32_t>(bytes.data() + 28) != maniscalco::io::crc32c(bytes.data(), 28))
+            throw std::runtime_error("container: header crc mismatch");
+        container_header header;
+        header.version_ = load<std::uint16_t>(bytes.data() + 8);
+        if (header.version_ != container_header::current_version)
+            throw std::runtime_error("container: unsupported version");
+        if (bytes[10] > (std::uint8_t)maniscalco::io::stream_direction::reverse)
+            throw std::runtime_error("container: invalid stream direction");
+        header.direction_ = (maniscalco::io::stream_direction)bytes[10];
+        header.indexed_ = ((bytes[11] & flag_indexed) != 0);
+        header.codec_ = load<std::uint32_t>(bytes.data() + 12);
+        header.bufferSize_ = load<std::uint64_t>(bytes.data() + 16);
+        return header;
+    }
+
+
+    //=========================================================================
+    record_header_bytes encode_record_header
+    (
+        std::uint32_t numBits,
+        std::uint8_t const * data,
+        size_type numBytes
+    )
+    {
+        record_header_bytes bytes;
+        store<std::uint32_t>(bytes.data(), numBits);
+        auto crc = maniscalco::io::crc32c(bytes.data(), sizeof(numBits));
+        store<std::uint32_t>(bytes.data() + sizeof(numBits), maniscalco::io::crc32c(data, numBytes, crc));
+        return bytes;
+    }
+
+
+    //=========================================================================
+    void check_record
+    (
+        // throws if 'crc' (of the record's bit count and data) does not match
+        // the crc in 'recordHeader'
+        record_header_bytes const & recordHeader,
+        std::uint32_t crc,
+        size_type packetNumber
+    )
+    {
+        if (crc != load<std::uint32_t>(recordHeader.data() + sizeof(std::uint32_t)))
+            throw std::runtime_error("container: crc mismatch in packet " + std::to_string(packetNumber));
+    }
+
+
+    //=========================================================================
+    void advance
+    (
+        // consume 'count' bytes from the front of the iovec range
+        iovec * & iov,
+        size_type & iovCount,
+        size_type count
+    )
+    {
+        while ((iovCount > 0) && (count >= (size_type)iov->iov_len))
+        {
+            count -= iov->iov_len;
+            ++iov;
+            --iovCount;
+        }
+        if (iovCount > 0)
+        {
+            iov->iov_base = reinterpret_cast<std::uint8_t *>(iov->iov_base) + count;
+            iov->iov_len -= count;
+        }
+    }
+
+
+    //=========================================================================
+    void write_all
+    (
+        int fd,
+        iovec * iov,
+        size_type iovCount
+    )
+    {
+        while (iovCount > 0)
+        {
+            auto written = ::writev(fd, iov, std::min(iovCount, max_iov));
+            if (written < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                throw_system_error("container_output_handler: writev failed");
+            }
+            advance(iov, iovCount, written);
+        }
+    }
+
+
+    //=========================================================================
+    class container_file final
+    {
+    public:
+
+        // a read only mapping of a container whose header (and index, when 
+        // present) have been validated.  record data is copied out of the 
+        // mapping and its crc computed in the same pass (see crc32c_copy).
+        container_file
+        (
+            std::string const & path
+        )
+        {
+            auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0)
+                throw_system_error("container: failed to open " + path);
+            struct stat fileStatus;
+            if (::fstat(fd, &fileStatus) != 0)
+            {
+                auto error = errno;
+                ::close(fd);
+                throw std::system_error(error, std::generic_category(), "container: failed to stat " + path);
+            }
+            fileSize_ = fileStatus.st_size;
+            if (fileSize_ < header_size)
+            {
+                ::close(fd);
+                throw std::runtime_error("container: truncated header");
+            }
+            auto address = ::mmap(nullptr, fileSize_, PROT_READ, MAP_SHARED, fd, 0);
+            auto error = errno;
+            ::close(fd); // mapping remains valid after close
+            if (address == MAP_FAILED)
+                throw std::system_error(error, std::generic_category(), "container: failed to map " + path);
+            data_ = reinterpret_cast<std::uint8_t const *>(address);
+            ::madvise(address, fileSize_, MADV_SEQUENTIAL);
+            try
+            {
+                header_bytes bytes;
+                std::memcpy(bytes.data(), data_, bytes.size());
+                header_ = decode_header(bytes);
+                if (header_.indexed_)
+                    read_index();
+            }
+            catch (...)
+            {
+                ::munmap(address, fileSize_);
+                throw;
+            }
+        }
+
+        ~container_file()
+        {
+            ::munmap(const_cast<std::uint8_t *>(data_), fileSize_);
+        }
+
+        container_file(container_file const &) = delete;
+        container_file & operator = (container_file const &) = delete;
+
+        bool read_record_header
+        (
+            // returns false at end of file
+            record_header_bytes & recordHeader,
+            size_type offset
+        ) const
+        {
+            if (offset == fileSize_)
+                return false;
+            if ((offset + record_header_size) > fileSize_)
+                throw std::runtime_error("container: truncated record header");
+            std::memcpy(recordHeader.data(), data_ + offset, recordHeader.size());
+            return true;
+        }
+
+        void check_record_size
+        (
+            // throws if 'numBytes' of record data at 'offset' and the record
+            // which must follow it do not fit within the packet records of the 
+            // file.  checked before the record's crc so that a corrupt bit 
+            // count is rejected before a buffer is allocated for it.
+            size_type numBytes,
+            size_type offset
+        ) const
+        {
+            auto end = (packetIndex_ ? dataEnd_ : fileSize_);
+            if ((offset + numBytes + record_header_size) > end)
+                throw std::runtime_error("container: record extends beyond the end of the file");
+        }
+
+        std::uint32_t read_record
+        (
+            // copy 'numBytes' of record data at 'offset' to 'data' and return
+            // the crc32c of the record's bit count and data
+            std::uint8_t * data,
+            size_type numBytes,
+            record_header_bytes const & recordHeader,
+            size_type offset
+        ) const
+        {
+            if ((offset + numBytes) > fileSize_)
+                throw std::runtime_error("container: truncated record");
+            populate(offset, offset + numBytes);
+            auto crc = maniscalco::io::crc32c(recordHeader.data(), sizeof(std::uint32_t));
+            return maniscalco::io::crc32c_copy(data, data_ + offset, numBytes, crc);
+        }
+
+        container_header const & header() const
+        {
+            return header_;
+        }
+
+        std::shared_ptr<maniscalco::io::packet_index const> packet_index() const
+        {
+            return packetIndex_;
+        }
+
+        size_type data_end() const
+        {
+            // offset of the first byte following the end record
+            return dataEnd_;
+        }
+
+    private:
+
+        // pages are mapped ahead of the reader this many bytes at a time
+        static size_type constexpr populate_size = (4 << 20);
+
+        void populate
+        (
+            // map the pages of [begin, end) and those following it ahead of 
+            // use so that records are not copied one page fault at a time
+            size_type begin,
+            size_type end
+        ) const
+        {
+            if ((begin >= populatedBegin_) && (end <= populatedEnd_))
+                return;
+            static auto const pageSize = (size_type)::sysconf(_SC_PAGESIZE);
+            populatedBegin_ = (begin & ~(pageSize - 1));
+            populatedEnd_ = std::min(fileSize_, std::max(end, populatedBegin_ + populate_size));
+            auto address = const_cast<std::uint8_t *>(data_ + populatedBegin_);
+            auto size = (populatedEnd_ - populatedBegin_);
+            #if defined(MADV_POPULATE_READ)
+                if (::madvise(address, size, MADV_POPULATE_READ) == 0)
+                    return;
+            #endif
+            ::madvise(address, size, MADV_WILLNEED);
+        }
+
+        void read_index()
+        {
+            if (fileSize_ < (header_size + record_header_size + trailer_size))
+                throw std::runtime_error("container: missing index trailer");
+            auto trailer = (data_ + fileSize_ - trailer_size);
+            if (load<std::uint32_t>(trailer + 12) != trailer_magic)
+                throw std::runtime_error("container: missing index trailer");
+            size_type indexOffset = load<std::uint64_t>(trailer);
+            if ((indexOffset < (header_size + record_header_size)) || (indexOffset > (fileSize_ - trailer_size)))
+                throw std::runtime_error("container: invalid index offset");
+            std::string index(reinterpret_cast<char const *>(data_ + indexOffset), fileSize_ - trailer_size - indexOffset);
+            if (maniscalco::io::crc32c(index.data(), index.size()) != load<std::uint32_t>(trailer + 8))
+                throw std::runtime_error("container: index crc mismatch");
+            std::istringstream stream(std::move(index));
+            packetIndex_ = std::make_shared<maniscalco::io::packet_index const>(maniscalco::io::packet_index::load(stream));
+            dataEnd_ = indexOffset;
+        }
+
+        std::uint8_t const * data_{nullptr};
+
+        size_type fileSize_{0};
+
+        size_type dataEnd_{0};
+
+        mutable size_type populatedBegin_{0};
+
+        mutable size_type populatedEnd_{0};
+
+        container_header header_;
+
+        std::shared_ptr<maniscalco::io::packet_index const> packetIndex_;
+    };
+
+} // namespace
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+class maniscalco::io::container_output_handler<S>::state final
+{
+public:
+
+    state
+    (
+        configuration_type const & configuration
+    ):
+        batchSize_(std::clamp<size_type>(configuration.batchSize_, 1, max_iov / 2)),
+        writeIndex_(configuration.writeIndex_)
+    {
+        fd_ = ::open(configuration.path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd_ < 0)
+            throw_system_error("container_output_handler: failed to open " + configuration.path_);
+        container_header header;
+        header.direction_ = S;
+        header.codec_ = configuration.codec_;
+        header.bufferSize_ = configuration.bufferSize_;
+        header.indexed_ = writeIndex_;
+        auto bytes = encode_header(header);
+        iovec iov{bytes.data(), bytes.size()};
+        try
+        {
+            write_all(fd_, &iov, 1);
+        }
+        catch (...)
+        {
+            ::close(fd_);
+            throw;
+        }
+        size_ = header_size;
+        packets_.reserve(batchSize_);
+        recordHeaders_.reserve(batchSize_);
+        iov_.reserve(batchSize_ * 2);
+    }
+
+    ~state()
+    {
+        try
+        {
+            close();
+        }
+        catch (...)
+        {
+        }
+    }
+
+    void write
+    (
+        packet_type packet
+    )
+    {
+        if (fd_ < 0)
+            throw std::runtime_error("container_output_handler: write after close");
+        if (packet.size() >= end_record_bits)
+            throw std::runtime_error("container_output_handler: packet too large");
+        auto [data, numBytes] = packet_record::bytes(packet);
+        recordHeaders_.push_back(encode_record_header(packet.size(), data, numBytes));
+        if (writeIndex_)
+            packetIndex_.append(packet.size(), record_header_size + numBytes);
+        size_ += (record_header_size + numBytes);
+        packets_.emplace_back(std::move(packet));
+        if ((size_type)packets_.size() >= batchSize_)
+            flush();
+    }
+
+    void flush()
+    {
+        if (packets_.empty())
+            return;
+        iov_.clear();
+        for (auto i = 0ull; i < packets_.size(); ++i)
+        {
+            auto [data, numBytes] = packet_record::bytes(packets_[i]);
+            iov_.push_back({recordHeaders_[i].data(), record_header_size});
+            iov_.push_back({const_cast<std::uint8_t *>(data), (std::size_t)numBytes});
+        }
+        write_all(fd_, iov_.data(), iov_.size());
+        packets_.clear();
+        recordHeaders_.clear();
+    }
+
+    void close()
+    {
+        if (fd_ < 0)
+            return;
+        flush();
+        auto endRecord = encode_record_header(end_record_bits, nullptr, 0);
+        size_ += record_header_size;
+        std::vector<iovec> iov{{endRecord.data(), endRecord.size()}};
+        std::string index;
+        trailer_bytes trailer;
+        if (writeIndex_)
+        {
+            std::ostringstream stream;
+            packetIndex_.save(stream);
+            index = std::move(stream).str();
+            store<std::uint64_t>(trailer.data(), size_);
+            store<std::uint32_t>(trailer.data() + 8, crc32c(index.data(), index.size()));
+            store<std::uint32_t>(trailer.data() + 12, trailer_magic);
+            iov.push_back({index.data(), index.size()});
+            iov.push_back({trailer.data(), trailer.size()});
+            size_ += (index.size() + trailer_size);
+        }
+        auto fd = std::exchange(fd_, -1);
+        try
+        {
+            write_all(fd, iov.data(), iov.size());
+        }
+        catch (...)
+        {
+            ::close(fd);
+            throw;
+        }
+        if (::close(fd) != 0)
+            throw_system_error("container_output_handler: close failed");
+    }
+
+    size_type size() const
+    {
+        return size_;
+    }
+
+private:
+
+    size_type const batchSize_;
+
+    bool const writeIndex_;
+
+    int fd_{-1};
+
+    size_type size_{0};
+
+    packet_index packetIndex_;
+
+    std::vector<packet_type> packets_;
+
+    std::vector<record_header_bytes> recordHeaders_;
+
+    std::vector<iovec> iov_;
+
+}; // class container_output_handler<S>::state
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+class maniscalco::io::container_input_handler<S>::state final
+{
+public:
+
+    state
+    (
+        configuration_type const & configuration
+    ):
+        file_(configuration.path_),
+        bufferAllocationHandler_(configuration.bufferAllocationHandler_ ?
+                configuration.bufferAllocationHandler_ : buffer_allocation_handler(buffer_pool()))
+    {
+        if (file_.header().direction_ != S)
+            throw std::runtime_error("container_input_handler: stream direction mismatch");
+    }
+
+    packet_type read()
+    {
+        if (ended_)
+            return {};
+        record_header_bytes recordHeader;
+        if (!file_.read_record_header(recordHeader, readOffset_))
+            throw std::runtime_error("container_input_handler: missing end record");
+        readOffset_ += record_header_size;
+        size_type numBits = load<std::uint32_t>(recordHeader.data());
+        if (numBits == end_record_bits)
+        {
+            check_record(recordHeader, crc32c(recordHeader.data(), sizeof(std::uint32_t)), packetNumber_);
+            ended_ = true;
+            return {};
+        }
+
+        auto numBytes = packet_record::byte_count(numBits);
+        file_.check_record_size(numBytes, readOffset_);
+        auto data = bufferAllocationHandler_();
+        if (data.capacity() < numBytes)
+            data = buffer(numBytes);
+        auto destination = data.data() + packet_record::data_offset<S>(data.capacity(), numBytes);
+        check_record(recordHeader, file_.read_record(destination, numBytes, recordHeader, readOffset_), packetNumber_++);
+        readOffset_ += numBytes;
+        return packet_record::make_packet<S>(std::move(data), numBits);
+    }
+
+    packet_type read
+    (
+        size_type packetNumber
+    )
+    {
+        auto packetIndex = file_.packet_index();
+        if (!packetIndex)
+            throw std::runtime_error("container_input_handler: random access requires an indexed container");
+        if ((packetNumber < 0) || (packetNumber >= packetIndex->packet_count()))
+            return {};
+        readOffset_ = (header_size + packetIndex->record_offset(packetNumber));
+        packetNumber_ = packetNumber;
+        ended_ = false;
+        return read();
+    }
+
+    container_header const & header() const
+    {
+        return file_.header();
+    }
+
+    std::shared_ptr<packet_index const> get_packet_index() const
+    {
+        return file_.packet_index();
+    }
+
+private:
+
+    container_file file_;
+
+    buffer_allocation_handler bufferAllocationHandler_;
+
+    size_type readOffset_{header_size};
+
+    size_type packetNumber_{0};
+
+    bool ended_{false};
+
+}; // class container_input_handler<S>::state
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+maniscalco::io::container_output_handler<S>::container_output_handler
+(
+    configuration_type const & configuration
+):
+    state_(std::make_shared<state>(configuration))
+{
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+void maniscalco::io::container_output_handler<S>::operator()
+(
+    packet_type packet
+)
+{
+    state_->write(std::move(packet));
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+void maniscalco::io::container_output_handler<S>::flush
+(
+    // write any partial batch
+)
+{
+    state_->flush();
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+void maniscalco::io::container_output_handler<S>::close
+(
+    // write pending packets, the end record and the index (if enabled)
+)
+{
+    state_->close();
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+auto maniscalco::io::container_output_handler<S>::size
+(
+    // returns number of bytes written (or pending) to the file
+) const -> size_type
+{
+    return state_->size();
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+maniscalco::io::container_input_handler<S>::container_input_handler
+(
+    configuration_type const & configuration
+):
+    state_(std::make_shared<state>(configuration))
+{
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+auto maniscalco::io::container_input_handler<S>::operator()
+(
+    // returns the next packet after checking its crc.
+    // returns an empty packet once the end record is reached.
+) -> packet_type
+{
+    return state_->read();
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+auto maniscalco::io::container_input_handler<S>::operator()
+(
+    // returns the packet numbered 'packetNumber' using the container's index.
+    // subsequent sequential reads continue from the following packet.
+    // returns an empty packet if 'packetNumber' is beyond the last packet.
+    size_type packetNumber
+) -> packet_type
+{
+    return state_->read(packetNumber);
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+auto maniscalco::io::container_input_handler<S>::header
+(
+) const -> container_header const &
+{
+    return state_->header();
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+auto maniscalco::io::container_input_handler<S>::get_packet_index
+(
+) const -> std::shared_ptr<packet_index const>
+{
+    return state_->get_packet_index();
+}
+
+
+//=============================================================================
+auto maniscalco::io::validate_container
+(
+    std::string const & path
+) -> container_header
+{
+    container_file file(path);
+    std::vector<std::uint8_t> data;
+    record_header_bytes recordHeader;
+    size_type readOffset = header_size;
+    size_type packetNumber = 0;
+    size_type totalBits = 0;
+    while (true)
+    {
+        if (!file.read_record_header(recordHeader, readOffset))
+            throw std::runtime_error("container: missing end record");
+        readOffset += record_header_size;
+        size_type numBits = load<std::uint32_t>(recordHeader.data());
+        if (numBits == end_record_bits)
+        {
+            check_record(recordHeader, crc32c(recordHeader.data(), sizeof(std::uint32_t)), packetNumber);
+            break;
+        }
+        auto numBytes = packet_record::byte_count(numBits);
+        file.check_record_size(numBytes, readOffset);
+        data.resize(numBytes);
+        check_record(recordHeader, file.read_record(data.data(), numBytes, recordHeader, readOffset), packetNumber++);
+        readOffset += numBytes;
+        totalBits += numBits;
+    }
+
+    if (auto packetIndex = file.packet_index(); packetIndex)
+    {
+        if ((packetIndex->packet_count() != packetNumber) || (packetIndex->size() != totalBits) ||
+                ((header_size + packetIndex->record_offset(packetNumber) + record_header_size) != file.data_end()))
+            throw std::runtime_error("container: index does not match packets");
+        if (readOffset != file.data_end())
+            throw std::runtime_error("container: unexpected data following end record");
+    }
+    return file.header();
+}
+
+
+//=============================================================================
+namespace maniscalco::io
+{
+    template class container_output_handler<stream_direction::forward>;
+    template class container_output_handler<stream_direction::reverse>;
+    template class container_input_handler<stream_direction::forward>;
+    template class container_input_handler<stream_direction::reverse>;
+
+} // maniscalco
@@ -0,0 +1,161 @@
+#pragma once
+
+#include "./buffer.h"
+#include "./stream_direction.h"
+#include "./stream_packet.h"
+#include "./packet_index.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+
+namespace maniscalco::io
+{
+
+    // self describing container file.  all fields are little endian.
+    //
+    //   header (32 bytes):
+    //     std::uint64_t  magic ("pstcntnr")
+    //     std::uint16_t  version
+    //     std::uint8_t   stream direction
+    //     std::uint8_t   flags (bit 0: trailing packet index present)
+    //     std::uint32_t  codec (application defined)
+    //     std::uint64_t  buffer size (bytes)
+    //     std::uint32_t  reserved
+    //     std::uint32_t  crc32c of the preceding 28 bytes
+    //
+    //   per packet record:
+    //     std::uint32_t  number of bits in packet
+    //     std::uint32_t  crc32c of the bit count and the packet data
+    //     std::uint8_t[] ((bits + 7) / 8) bytes of packet data (see packet_record.h)
+    //
+    //   end record:     bits = 0xffffffff, crc32c of the bit count
+    //
+    //   optional index: packet_index (see packet_index::save) whose record
+    //                   offsets are relative to the first packet record,
+    //                   followed by a trailer:
+    //     std::uint64_t  byte offset of the index
+    //     std::uint32_t  crc32c of the index
+    //     std::uint32_t  trailer magic ("pidx")
+    //
+    // every packet is checked against its crc as it is read so corruption
+    // and truncation are detected without decoding the stream.
+    struct container_header
+    {
+        using size_type = std::int64_t;
+
+        static std::uint16_t constexpr current_version = 1;
+
+        std::uint16_t version_{current_version};
+        stream_direction direction_{stream_direction::forward};
+        std::uint32_t codec_{0};
+        size_type bufferSize_{0};
+        bool indexed_{false};
+    };
+
+
+    template <stream_direction S>
+    class container_output_handler final
+    {
+    public:
+
+        using size_type = std::int64_t;
+        using packet_type = stream_packet<S>;
+
+        static size_type constexpr default_batch_size = 64;
+
+        struct configuration_type
+        {
+            std::string path_;
+            std::uint32_t codec_{0};
+            // recorded in the header for the reader's benefit
+            size_type bufferSize_{0};
+            bool writeIndex_{true};
+            // packets coalesced into a single writev
+            size_type batchSize_{default_batch_size};
+        };
+
+        container_output_handler(configuration_type const &);
+
+        // copies share the same underlying file
+        container_output_handler(container_output_handler const &) = default;
+        container_output_handler & operator = (container_output_handler const &) = default;
+
+        ~container_output_handler() = default;
+
+        void operator()
+        (
+            packet_type
+        );
+
+        void flush();
+
+        void close();
+
+        size_type size() const;
+
+    private:
+
+        class state;
+
+        std::shared_ptr<state> state_;
+
+    }; // class container_output_handler
+
+
+    template <stream_direction S>
+    class container_input_handler final
+    {
+    public:
+
+        using size_type = std::int64_t;
+        using packet_type = stream_packet<S>;
+        using buffer_allocation_handler = std::function<buffer()>;
+
+        struct configuration_type
+        {
+            std::string path_;
+            // defaults to a buffer_pool
+            buffer_allocation_handler bufferAllocationHandler_;
+        };
+
+        container_input_handler(configuration_type const &);
+
+        // copies share the same file and read position
+        container_input_handler(container_input_handler const &) = default;
+        container_input_handler & operator = (container_input_handler const &) = default;
+
+        ~container_input_handler() = default;
+
+        packet_type operator()();
+
+        packet_type operator()
+        (
+            size_type
+        );
+
+        container_header const & header() const;
+
+        // the trailing index or nullptr if the container was written without one
+        std::shared_ptr<packet_index const> get_packet_index() const;
+
+    private:
+
+        class state;
+
+        std::shared_ptr<state> state_;
+
+    }; // class container_input_handler
+
+
+    // checks the header, every packet crc and the index (if present) without
+    // decoding.  returns the header or throws std::runtime_error describing
+    // the first problem found.
+    container_header validate_container
+    (
+        std::string const & path
+    );
+
+} // namespace maniscalco::io
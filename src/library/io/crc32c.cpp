@@ -0,0 +1,290 @@
+#include "./crc32c.h"
+
+#include <array>
+#include <bit>
+#include <cstring>
+
+#if defined(__x86_64__)
+    #include <nmmintrin.h>
+#endif
+
+
+namespace
+{
+
+    using size_type = std::int64_t;
+
+    static std::uint32_t constexpr polynomial = 0x82f63b78; // reflected castagnoli polynomial
+
+    // the hardware path computes three independent crcs over adjacent blocks
+    // and combines them by shifting the crc of earlier blocks over the later
+    // blocks (equivalent to appending that many zero bytes)
+    static size_type constexpr long_block_size = 8192;
+    static size_type constexpr short_block_size = 256;
+
+    using shift_table = std::array<std::array<std::uint32_t, 256>, 4>;
+
+
+    //=========================================================================
+    auto constexpr slice_table = []()
+            {
+                std::array<std::array<std::uint32_t, 256>, 8> table{};
+                for (std::uint32_t n = 0; n < 256; ++n)
+                {
+                    auto crc = n;
+                    for (auto k = 0; k < 8; ++k)
+                        crc = (crc & 1) ? ((crc >> 1) ^ polynomial) : (crc >> 1);
+                    table[0][n] = crc;
+                }
+                for (std::uint32_t n = 0; n < 256; ++n)
+                    for (auto k = 1; k < 8; ++k)
+                        table[k][n] = ((table[k - 1][n] >> 8) ^ table[0][table[k - 1][n] & 0xff]);
+                return table;
+            }();
+
+
+    //=========================================================================
+    std::uint32_t crc32c_software
+    (
+        std::uint8_t const * data,
+        size_type size,
+        std::uint32_t crc
+    )
+    {
+        crc = ~crc;
+        while ((size > 0) && (reinterpret_cast<std::uintptr_t>(data) & 7))
+        {
+            crc = ((crc >> 8) ^ slice_table[0][(crc ^ *data++) & 0xff]);
+            --size;
+        }
+        while (size >= 8)
+        {
+            std::uint64_t word;
+            std::memcpy(&word, data, sizeof(word));
+            if constexpr (std::endian::native == std::endian::big)
+                word = __builtin_bswap64(word);
+            word ^= crc;
+            crc = slice_table[7][word & 0xff] ^
+                    slice_table[6][(word >> 8) & 0xff] ^
+                    slice_table[5][(word >> 16) & 0xff] ^
+                    slice_table[4][(word >> 24) & 0xff] ^
+                    slice_table[3][(word >> 32) & 0xff] ^
+                    slice_table[2][(word >> 40) & 0xff] ^
+                    slice_table[1][(word >> 48) & 0xff] ^
+                    slice_table[0][word >> 56];
+            data += 8;
+            size -= 8;
+        }
+        while (size-- > 0)
+            crc = ((crc >> 8) ^ slice_table[0][(crc ^ *data++) & 0xff]);
+        return ~crc;
+    }
+
+
+#if defined(__x86_64__)
+
+    //=========================================================================
+    std::uint32_t gf2_matrix_times
+    (
+        std::uint32_t const * matrix,
+        std::uint32_t vector
+    )
+    {
+        std::uint32_t sum = 0;
+        for (; vector; vector >>= 1, ++matrix)
+            if (vector & 1)
+                sum ^= *matrix;
+        return sum;
+    }
+
+
+    //=========================================================================
+    void gf2_matrix_square
+    (
+        std::uint32_t * square,
+        std::uint32_t const * matrix
+    )
+    {
+        for (auto n = 0; n < 32; ++n)
+            square[n] = gf2_matrix_times(matrix, matrix[n]);
+    }
+
+
+    //=========================================================================
+    shift_table make_shift_table
+    (
+        // table which shifts a crc over 'size' zero bytes.  size must be a power of two
+        size_type size
+    )
+    {
+        std::uint32_t even[32];
+        std::uint32_t odd[32];
+        odd[0] = polynomial;
+        for (std::uint32_t n = 1, row = 1; n < 32; ++n, row <<= 1)
+            odd[n] = row;
+        gf2_matrix_square(even, odd);   // two zero bits
+        gf2_matrix_square(odd, even);   // four zero bits
+        auto * result = even;
+        while (true)
+        {
+            gf2_matrix_square(even, odd);
+            result = even;
+            if ((size >>= 1) == 0)
+                break;
+            gf2_matrix_square(odd, even);
+            result = odd;
+            if ((size >>= 1) == 0)
+                break;
+        }
+        shift_table table;
+        for (std::uint32_t n = 0; n < 256; ++n)
+            for (auto k = 0; k < 4; ++k)
+                table[k][n] = gf2_matrix_times(result, n << (k * 8));
+        return table;
+    }
+
+
+    //=========================================================================
+    inline std::uint32_t shift
+    (
+        shift_table const & table,
+        std::uint32_t crc
+    )
+    {
+        return table[0][crc & 0xff] ^ table[1][(crc >> 8) & 0xff] ^ table[2][(crc >> 16) & 0xff] ^ table[3][crc >> 24];
+    }
+
+
+    //=========================================================================
+    template <bool copy, size_type block_size>
+    __attribute__((target("sse4.2"))) inline std::uint64_t crc32c_three_blocks
+    (
+        // crc three adjacent blocks of 'block_size' bytes at a time.  when 
+        // 'copy' is set each word is also stored to 'destination'.
+        std::uint8_t * & destination,
+        std::uint8_t const * & data,
+        size_type & size,
+        std::uint64_t crc,
+        shift_table const & table
+    )
+    {
+        while (size >= (block_size * 3))
+        {
+            std::uint64_t crc1 = 0;
+            std::uint64_t crc2 = 0;
+            auto end = data + block_size;
+            do
+            {
+                std::uint64_t word0, word1, word2;
+                std::memcpy(&word0, data, sizeof(word0));
+                std::memcpy(&word1, data + block_size, sizeof(word1));
+                std::memcpy(&word2, data + (block_size * 2), sizeof(word2));
+                crc = _mm_crc32_u64(crc, word0);
+                crc1 = _mm_crc32_u64(crc1, word1);
+                crc2 = _mm_crc32_u64(crc2, word2);
+                if constexpr (copy)
+                {
+                    std::memcpy(destination, &word0, sizeof(word0));
+                    std::memcpy(destination + block_size, &word1, sizeof(word1));
+                    std::memcpy(destination + (block_size * 2), &word2, sizeof(word2));
+                    destination += 8;
+                }
+                data += 8;
+            } while (data < end);
+            crc = shift(table, crc) ^ crc1;
+            crc = shift(table, crc) ^ crc2;
+            if constexpr (copy)
+                destination += (block_size * 2);
+            data += (block_size * 2);
+            size -= (block_size * 3);
+        }
+        return crc;
+    }
+
+
+    //=========================================================================
+    template <bool copy>
+    __attribute__((target("sse4.2"))) std::uint32_t crc32c_hardware
+    (
+        // 'destination' is only used when 'copy' is set
+        std::uint8_t * destination,
+        std::uint8_t const * data,
+        size_type size,
+        std::uint32_t crc
+    )
+    {
+        static shift_table const long_shift = make_shift_table(long_block_size);
+        static shift_table const short_shift = make_shift_table(short_block_size);
+
+        std::uint64_t crc0 = ~crc;
+        while ((size > 0) && (reinterpret_cast<std::uintptr_t>(data) & 7))
+        {
+            if constexpr (copy)
+                *destination++ = *data;
+            crc0 = _mm_crc32_u8(crc0, *data++);
+            --size;
+        }
+        crc0 = crc32c_three_blocks<copy, long_block_size>(destination, data, size, crc0, long_shift);
+        crc0 = crc32c_three_blocks<copy, short_block_size>(destination, data, size, crc0, short_shift);
+        while (size >= 8)
+        {
+            std::uint64_t word;
+            std::memcpy(&word, data, sizeof(word));
+            if constexpr (copy)
+            {
+                std::memcpy(destination, &word, sizeof(word));
+                destination += 8;
+            }
+            crc0 = _mm_crc32_u64(crc0, word);
+            data += 8;
+            size -= 8;
+        }
+        while (size-- > 0)
+        {
+            if constexpr (copy)
+                *destination++ = *data;
+            crc0 = _mm_crc32_u8(crc0, *data++);
+        }
+        return ~(std::uint32_t)crc0;
+    }
+
+#endif
+
+} // namespace
+
+
+//=============================================================================
+std::uint32_t maniscalco::io::crc32c
+(
+    void const * data,
+    std::int64_t size,
+    std::uint32_t crc
+)
+{
+    #if defined(__x86_64__)
+        static bool const hardware = __builtin_cpu_supports("sse4.2");
+        if (hardware)
+            return crc32c_hardware<false>(nullptr, reinterpret_cast<std::uint8_t const *>(data), size, crc);
+    #endif
+    return crc32c_software(reinterpret_cast<std::uint8_t const *>(data), size, crc);
+}
+
+
+//=============================================================================
+std::uint32_t maniscalco::io::crc32c_copy
+(
+    void * destination,
+    void const * source,
+    std::int64_t size,
+    std::uint32_t crc
+)
+{
+    #if defined(__x86_64__)
+        static bool const hardware = __builtin_cpu_supports("sse4.2");
+        if (hardware)
+            return crc32c_hardware<true>(reinterpret_cast<std::uint8_t *>(destination), 
+                    reinterpret_cast<std::uint8_t const *>(source), size, crc);
+    #endif
+    std::memcpy(destination, source, size);
+    return crc32c_software(reinterpret_cast<std::uint8_t const *>(destination), size, crc);
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+
+
+namespace maniscalco::io
+{
+
+    // crc32c (castagnoli).  uses the sse4.2 crc32 instruction, three streams
+    // at a time, when the cpu supports it and a slice by 8 table otherwise.
+    // 'crc' is the crc of any preceding data so that crc32c may be computed
+    // incrementally.
+    std::uint32_t crc32c
+    (
+        void const * data,
+        std::int64_t size,
+        std::uint32_t crc = 0
+    );
+
+    // copies 'size' bytes from 'source' to 'destination' and returns their
+    // crc32c as above.  the crc is computed from the words as they are copied
+    // so that the data is only read once.
+    std::uint32_t crc32c_copy
+    (
+        void * destination,
+        void const * source,
+        std::int64_t size,
+        std::uint32_t crc = 0
+    );
+
+} // namespace maniscalco::io
@@ -0,0 +1,625 @@
+#include "./direct_file.h"
+#include "./packet_record.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace
+{
+
+    using size_type = std::int64_t;
+
+    static std::uint64_t constexpr footer_magic = 0x7463657269646f69; // "iodirect"
+
+
+    struct footer_type
+    {
+        std::uint64_t magic_;
+        std::uint64_t packetCount_;
+        std::uint64_t bitCountOffset_;
+        std::uint32_t alignment_;
+        std::uint32_t direction_;
+    };
+
+    static_assert(sizeof(footer_type) == 32);
+
+
+    //=========================================================================
+    [[noreturn]] void throw_system_error
+    (
+        std::string const & what
+    )
+    {
+        throw std::system_error(errno, std::generic_category(), what);
+    }
+
+
+    //=========================================================================
+    size_type round_up
+    (
+        size_type size,
+        size_type alignment
+    )
+    {
+        return ((size + alignment - 1) & ~(alignment - 1));
+    }
+
+
+    //=========================================================================
+    void validate_alignment
+    (
+        size_type alignment
+    )
+    {
+        if ((alignment < 512) || ((alignment & (alignment - 1)) != 0))
+            throw std::runtime_error("direct_file: alignment must be a power of two of at least 512");
+    }
+
+
+    //=========================================================================
+    using aligned_memory = std::unique_ptr<std::uint8_t [], decltype(&std::free)>;
+
+    aligned_memory allocate_aligned
+    (
+        size_type size,
+        size_type alignment
+    )
+    {
+        auto p = (std::uint8_t *)std::aligned_alloc(alignment, round_up(size, alignment));
+        if (p == nullptr)
+            throw std::bad_alloc();
+        return {p, &std::free};
+    }
+
+
+    //=========================================================================
+    int open_direct
+    (
+        // open with O_DIRECT if the file system supports it.  'direct' is set
+        // to indicate whether it does.
+        std::string const & path,
+        int flags,
+        bool & direct
+    )
+    {
+        #if defined(O_DIRECT)
+            if (auto fd = ::open(path.c_str(), flags | O_DIRECT, 0644); fd >= 0)
+            {
+                direct = true;
+                return fd;
+            }
+            if (errno != EINVAL)
+                return -1;
+        #endif
+        direct = false;
+        return ::open(path.c_str(), flags, 0644);
+    }
+
+
+    //=========================================================================
+    void disable_direct
+    (
+        // some file systems accept O_DIRECT at open but reject direct io
+        int fd,
+        bool & direct
+    )
+    {
+        #if defined(O_DIRECT)
+            ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) & ~O_DIRECT);
+        #endif
+        direct = false;
+    }
+
+} // namespace
+
+
+//=============================================================================
+auto maniscalco::io::aligned_buffer_allocator::operator()
+(
+    // capacity is bufferSize_ rounded up to the alignment.  one alignment
+    // of zeroed memory before and after the buffer provides its slack.
+) const -> buffer
+{
+    validate_alignment(alignment_);
+    auto capacity = round_up(std::max<size_type>(bufferSize_, 1), alignment_);
+    auto memory = allocate_aligned(capacity + (2 * alignment_), alignment_);
+    std::memset(memory.get(), 0x00, alignment_);
+    std::memset(memory.get() + alignment_ + capacity, 0x00, alignment_);
+    auto alignment = alignment_;
+    return buffer(memory.release() + alignment_, capacity, [alignment](auto * p){std::free(p - alignment);}, buffer::slack_size);
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+class maniscalco::io::direct_file_output_handler<S>::state final
+{
+public:
+
+    state
+    (
+        configuration_type const & configuration
+    ):
+        alignment_(configuration.alignment_),
+        stagingCapacity_(round_up(std::max(configuration.writeSize_, configuration.alignment_), configuration.alignment_)),
+        staging_(nullptr, &std::free)
+    {
+        validate_alignment(alignment_);
+        staging_ = allocate_aligned(stagingCapacity_, alignment_);
+        fd_ = open_direct(configuration.path_, O_WRONLY | O_CREAT | O_TRUNC, direct_);
+        if (fd_ < 0)
+            throw_system_error("direct_file_output_handler: failed to open " + configuration.path_);
+    }
+
+    ~state()
+    {
+        try
+        {
+            close();
+        }
+        catch (...)
+        {
+        }
+    }
+
+    void write
+    (
+        packet_type const & packet
+    )
+    {
+        if (fd_ < 0)
+            throw std::runtime_error("direct_file_output_handler: write after close");
+        bitCounts_.push_back(packet.size());
+        auto [source, numBytes] = packet_record::bytes(packet);
+        auto padded = round_up(numBytes, alignment_);
+        // the padded record within the packet's own buffer
+        auto record = (S == stream_direction::forward) ? source : (source + numBytes - padded);
+        if ((padded >= stagingCapacity_) && (((std::uintptr_t)record & (alignment_ - 1)) == 0) &&
+                (record >= packet.data()) && ((record + padded) <= (packet.data() + packet.capacity())))
+        {
+            // large packet in an aligned buffer.  bytes of the record beyond
+            // the packet are not read back.
+            flush();
+            write_at(record, padded);
+            return;
+        }
+        if constexpr (S == stream_direction::forward)
+        {
+            append(source, numBytes);
+            append(nullptr, padded - numBytes);
+        }
+        else
+        {
+            append(nullptr, padded - numBytes);
+            append(source, numBytes);
+        }
+    }
+
+    void close()
+    {
+        if (fd_ < 0)
+            return;
+        footer_type footer{footer_magic, bitCounts_.size(), (std::uint64_t)size(), (std::uint32_t)alignment_, (std::uint32_t)S};
+        append((std::uint8_t const *)bitCounts_.data(), bitCounts_.size() * sizeof(std::uint64_t));
+        append(nullptr, round_up(stagingSize_ + sizeof(footer), alignment_) - stagingSize_ - sizeof(footer));
+        append((std::uint8_t const *)&footer, sizeof(footer));
+        flush();
+        auto fd = std::exchange(fd_, -1);
+        if (::close(fd) != 0)
+            throw_system_error("direct_file_output_handler: close failed");
+    }
+
+    size_type size() const
+    {
+        return (fileOffset_ + stagingSize_);
+    }
+
+    bool direct() const
+    {
+        return direct_;
+    }
+
+private:
+
+    void append
+    (
+        // copy to the staging buffer (or zeros where 'source' is nullptr)
+        std::uint8_t const * source,
+        size_type size
+    )
+    {
+        while (size > 0)
+        {
+            auto n = std::min(size, stagingCapacity_ - stagingSize_);
+            if (source != nullptr)
+                std::memcpy(staging_.get() + stagingSize_, source, n);
+            else
+                std::memset(staging_.get() + stagingSize_, 0x00, n);
+            stagingSize_ += n;
+            size -= n;
+            if (source != nullptr)
+                source += n;
+            if (stagingSize_ == stagingCapacity_)
+                flush();
+        }
+    }
+
+    void flush()
+    {
+        // records and the trailer are multiples of the alignment so the
+        // staged bytes always are too
+        if (stagingSize_ > 0)
+            write_at(staging_.get(), stagingSize_);
+        stagingSize_ = 0;
+    }
+
+    void write_at
+    (
+        std::uint8_t const * source,
+        size_type size
+    )
+    {
+        while (size > 0)
+        {
+            auto n = ::pwrite(fd_, source, size, fileOffset_);
+            if ((n < 0) && (errno == EINVAL) && (direct_))
+            {
+                disable_direct(fd_, direct_);
+                continue;
+            }
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                throw_system_error("direct_file_output_handler: write failed");
+            }
+            source += n;
+            size -= n;
+            fileOffset_ += n;
+        }
+    }
+
+    size_type const alignment_;
+
+    size_type const stagingCapacity_;
+
+    aligned_memory staging_;
+
+    size_type stagingSize_{0};
+
+    size_type fileOffset_{0};
+
+    int fd_{-1};
+
+    bool direct_{false};
+
+    std::vector<std::uint64_t> bitCounts_;
+
+}; // class direct_file_output_handler<S>::state
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+class maniscalco::io::direct_file_input_handler<S>::state final
+{
+public:
+
+    state
+    (
+        configuration_type const & configuration
+    ):
+        readSize_(configuration.readSize_),
+        readAhead_(nullptr, &std::free)
+    {
+        // the trailer is read through the page cache since its alignment is
+        // not known until it has been read
+        fd_ = ::open(configuration.path_.c_str(), O_RDONLY);
+        if (fd_ < 0)
+            throw_system_error("direct_file_input_handler: failed to open " + configuration.path_);
+        try
+        {
+            read_trailer();
+        }
+        catch (...)
+        {
+            ::close(fd_);
+            throw;
+        }
+        #if defined(O_DIRECT)
+            direct_ = (::fcntl(fd_, F_SETFL, ::fcntl(fd_, F_GETFL) | O_DIRECT) == 0);
+        #endif
+        readSize_ = round_up(std::max(readSize_, alignment_), alignment_);
+        readAhead_ = allocate_aligned(readSize_, alignment_);
+    }
+
+    ~state()
+    {
+        ::close(fd_);
+    }
+
+    packet_type read()
+    {
+        if (empty())
+            return {};
+        auto packetNumber = nextPacket_++;
+        auto numBits = bitCounts_[packetNumber];
+        auto numBytes = packet_record::byte_count(numBits);
+        auto offset = recordOffsets_[packetNumber];
+        auto padded = (recordOffsets_[packetNumber + 1] - offset);
+        if (padded >= readSize_)
+        {
+            // read the whole record directly into the packet's buffer
+            auto data = aligned_buffer_allocator{padded, alignment_}();
+            read_at(data.data(), padded, offset);
+            return packet_record::make_packet<S>(std::move(data), numBits);
+        }
+        if ((offset < readAheadOffset_) || ((offset + padded) > (readAheadOffset_ + readAheadSize_)))
+        {
+            readAheadOffset_ = offset;
+            readAheadSize_ = std::min(readSize_, recordOffsets_.back() - offset);
+            read_at(readAhead_.get(), readAheadSize_, readAheadOffset_);
+        }
+        auto source = readAhead_.get() + (offset - readAheadOffset_) +
+                ((S == stream_direction::forward) ? 0 : (padded - numBytes));
+        buffer data(numBytes);
+        std::memcpy(data.data(), source, numBytes);
+        return packet_record::make_packet<S>(std::move(data), numBits);
+    }
+
+    packet_type read
+    (
+        size_type packetNumber
+    )
+    {
+        if ((packetNumber < 0) || (packetNumber >= packet_count()))
+            return {};
+        nextPacket_ = packetNumber;
+        return read();
+    }
+
+    bool empty() const
+    {
+        return (nextPacket_ >= packet_count());
+    }
+
+    size_type packet_count() const
+    {
+        return (size_type)bitCounts_.size();
+    }
+
+    bool direct() const
+    {
+        return direct_;
+    }
+
+private:
+
+    void read_trailer()
+    {
+        struct stat fileStatus;
+        if (::fstat(fd_, &fileStatus) != 0)
+            throw_system_error("direct_file_input_handler: failed to stat file");
+        footer_type footer;
+        auto fileSize = (size_type)fileStatus.st_size;
+        if ((fileSize < (size_type)sizeof(footer)) ||
+                (::pread(fd_, &footer, sizeof(footer), fileSize - sizeof(footer)) != (ssize_t)sizeof(footer)) ||
+                (footer.magic_ != footer_magic))
+            throw std::runtime_error("direct_file_input_handler: missing trailer (file not closed?)");
+        if (footer.direction_ != (std::uint32_t)S)
+            throw std::runtime_error("direct_file_input_handler: stream direction mismatch");
+        alignment_ = footer.alignment_;
+        validate_alignment(alignment_);
+        // bound the untrusted count and offset by the file before using them
+        auto maxSize = fileSize - (size_type)sizeof(footer);
+        if ((footer.packetCount_ > (std::uint64_t)(maxSize / (size_type)sizeof(std::uint64_t))) ||
+                (footer.bitCountOffset_ > (std::uint64_t)maxSize))
+            throw std::runtime_error("direct_file_input_handler: invalid trailer");
+        auto bitCountSize = (size_type)(footer.packetCount_ * sizeof(std::uint64_t));
+        if (((size_type)footer.bitCountOffset_ + bitCountSize) > maxSize)
+            throw std::runtime_error("direct_file_input_handler: invalid trailer");
+        bitCounts_.resize(footer.packetCount_);
+        if (auto n = ::pread(fd_, bitCounts_.data(), bitCountSize, footer.bitCountOffset_); n < 0)
+            throw_system_error("direct_file_input_handler: failed to read trailer");
+        else if (n != bitCountSize)
+            throw std::runtime_error("direct_file_input_handler: truncated trailer");
+        recordOffsets_.reserve(bitCounts_.size() + 1);
+        recordOffsets_.push_back(0);
+        for (auto numBits : bitCounts_)
+            recordOffsets_.push_back(recordOffsets_.back() + round_up(packet_record::byte_count(numBits), alignment_));
+        if (recordOffsets_.back() != (size_type)footer.bitCountOffset_)
+            throw std::runtime_error("direct_file_input_handler: invalid trailer");
+    }
+
+    void read_at
+    (
+        std::uint8_t * destination,
+        size_type size,
+        size_type offset
+    )
+    {
+        while (size > 0)
+        {
+            auto n = ::pread(fd_, destination, size, offset);
+            if ((n < 0) && (errno == EINVAL) && (direct_))
+            {
+                disable_direct(fd_, direct_);
+                continue;
+            }
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                throw_system_error("direct_file_input_handler: read failed");
+            }
+            if (n == 0)
+                throw std::runtime_error("direct_file_input_handler: truncated file");
+            destination += n;
+            size -= n;
+            offset += n;
+        }
+    }
+
+    int fd_{-1};
+
+    bool direct_{false};
+
+    size_type alignment_{0};
+
+    size_type readSize_;
+
+    std::vector<std::uint64_t> bitCounts_;
+
+    // offset of each packet's record and, finally, of the trailer
+    std::vector<size_type> recordOffsets_;
+
+    size_type nextPacket_{0};
+
+    aligned_memory readAhead_;
+
+    size_type readAheadOffset_{0};
+
+    size_type readAheadSize_{0};
+
+}; // class direct_file_input_handler<S>::state
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+maniscalco::io::direct_file_output_handler<S>::direct_file_output_handler
+(
+    configuration_type const & configuration
+):
+    state_(std::make_shared<state>(configuration))
+{
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+void maniscalco::io::direct_file_output_handler<S>::operator()
+(
+    packet_type packet
+)
+{
+    state_->write(packet);
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+void maniscalco::io::direct_file_output_handler<S>::close
+(
+)
+{
+    state_->close();
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+auto maniscalco::io::direct_file_output_handler<S>::size
+(
+) const -> size_type
+{
+    return state_->size();
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+bool maniscalco::io::direct_file_output_handler<S>::direct
+(
+    // false where the file system does not support O_DIRECT
+) const
+{
+    return state_->direct();
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+maniscalco::io::direct_file_input_handler<S>::direct_file_input_handler
+(
+    configuration_type const & configuration
+):
+    state_(std::make_shared<state>(configuration))
+{
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+auto maniscalco::io::direct_file_input_handler<S>::operator()
+(
+    // returns the next packet.  returns an empty packet at the end of file.
+) -> packet_type
+{
+    return state_->read();
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+auto maniscalco::io::direct_file_input_handler<S>::operator()
+(
+    // returns the packet numbered 'packetNumber'.  subsequent sequential
+    // reads continue from the following packet.  returns an empty packet if
+    // 'packetNumber' is beyond the last packet.
+    size_type packetNumber
+) -> packet_type
+{
+    return state_->read(packetNumber);
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+bool maniscalco::io::direct_file_input_handler<S>::empty
+(
+) const
+{
+    return state_->empty();
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+auto maniscalco::io::direct_file_input_handler<S>::packet_count
+(
+) const -> size_type
+{
+    return state_->packet_count();
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+bool maniscalco::io::direct_file_input_handler<S>::direct
+(
+    // false where the file system does not support O_DIRECT
+) const
+{
+    return state_->direct();
+}
+
+
+//=============================================================================
+namespace maniscalco::io
+{
+    template class direct_file_output_handler<stream_direction::forward>;
+    template class direct_file_output_handler<stream_direction::reverse>;
+    template class direct_file_input_handler<stream_direction::forward>;
+    template class direct_file_input_handler<stream_direction::reverse>;
+
+} // maniscalco
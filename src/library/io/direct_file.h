@@ -0,0 +1,145 @@
+#pragma once
+
+#include "./buffer.h"
+#include "./stream_direction.h"
+#include "./stream_packet.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+
+namespace maniscalco::io
+{
+
+    // files written with O_DIRECT so that packets bypass the page cache.
+    // every read and write is a multiple of the alignment at an aligned file
+    // offset from aligned memory.
+    //
+    // layout:
+    //   each packet padded to a multiple of the alignment.  forward packets
+    //   occupy the leading bytes of the padded record and reverse packets the
+    //   trailing bytes (as in packet_record).
+    //   trailer: the bit count of every packet (std::uint64_t), zero padding,
+    //   and a 32 byte footer (magic, packet count, offset of the bit counts,
+    //   alignment and direction) ending the file.
+    //
+    // where the file system does not support O_DIRECT (tmpfs for instance)
+    // the same file is written and read through the page cache.
+
+    // allocates buffers whose begin() and capacity are multiples of the
+    // alignment so that direct_file_output_handler writes large packets
+    // from them without first copying.
+    struct aligned_buffer_allocator
+    {
+        using size_type = std::int64_t;
+
+        static size_type constexpr default_alignment = 4096;
+
+        size_type bufferSize_;
+        size_type alignment_{default_alignment};
+
+        buffer operator()() const;
+    };
+
+
+    template <stream_direction S>
+    class direct_file_output_handler final
+    {
+    public:
+
+        using size_type = std::int64_t;
+        using packet_type = stream_packet<S>;
+
+        static size_type constexpr default_alignment = aligned_buffer_allocator::default_alignment;
+        static size_type constexpr default_write_size = (1ll << 20);
+
+        struct configuration_type
+        {
+            std::string path_;
+            // power of two.  at least the logical block size of the device.
+            size_type alignment_{default_alignment};
+            // smaller packets are gathered and written in writes of this size.
+            // packets of at least this size whose records lie within an aligned
+            // buffer (see aligned_buffer_allocator) are written directly.
+            size_type writeSize_{default_write_size};
+        };
+
+        direct_file_output_handler(configuration_type const &);
+
+        // copies share the same underlying file
+        direct_file_output_handler(direct_file_output_handler const &) = default;
+        direct_file_output_handler & operator = (direct_file_output_handler const &) = default;
+
+        ~direct_file_output_handler() = default;
+
+        void operator()
+        (
+            packet_type
+        );
+
+        // writes the trailer.  the file is incomplete until closed.
+        void close();
+
+        // bytes written to the file (including padding)
+        size_type size() const;
+
+        bool direct() const;
+
+    private:
+
+        class state;
+
+        std::shared_ptr<state> state_;
+
+    }; // class direct_file_output_handler
+
+
+    template <stream_direction S>
+    class direct_file_input_handler final
+    {
+    public:
+
+        using size_type = std::int64_t;
+        using packet_type = stream_packet<S>;
+
+        static size_type constexpr default_read_size = (1ll << 20);
+
+        struct configuration_type
+        {
+            std::string path_;
+            // smaller packets are read ahead in reads of this size and copied.
+            // larger packets are read directly into their own buffers.
+            size_type readSize_{default_read_size};
+        };
+
+        direct_file_input_handler(configuration_type const &);
+
+        // copies share the same underlying file and read position
+        direct_file_input_handler(direct_file_input_handler const &) = default;
+        direct_file_input_handler & operator = (direct_file_input_handler const &) = default;
+
+        ~direct_file_input_handler() = default;
+
+        packet_type operator()();
+
+        packet_type operator()
+        (
+            size_type
+        );
+
+        bool empty() const;
+
+        size_type packet_count() const;
+
+        bool direct() const;
+
+    private:
+
+        class state;
+
+        std::shared_ptr<state> state_;
+
+    }; // class direct_file_input_handler
+
+} // namespace maniscalco::io
@@ -0,0 +1,431 @@
+#include "./huffman.h"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+
+namespace
+{
+
+    using size_type = std::int64_t;
+
+
+    //=========================================================================
+    std::uint32_t reverse_bits
+    (
+        std::uint32_t code,
+        size_type length
+    )
+    {
+        std::uint32_t result = 0;
+        for (auto i = 0; i < length; ++i, code >>= 1)
+            result = ((result << 1) | (code & 1));
+        return result;
+    }
+
+
+    //=========================================================================
+    std::vector<std::uint32_t> make_canonical_codes
+    (
+        // assign canonical codes in (length, symbol) order.  throws if the
+        // lengths are over subscribed.
+        std::span<std::uint8_t const> codeLengths
+    )
+    {
+        std::vector<std::uint32_t> lengthCount(maniscalco::io::huffman_max_code_length + 1, 0);
+        for (auto length : codeLengths)
+        {
+            if (length > maniscalco::io::huffman_max_code_length)
+                throw std::runtime_error("huffman: code length exceeds huffman_max_code_length");
+            ++lengthCount[length];
+        }
+        lengthCount[0] = 0;
+
+        std::uint64_t kraft = 0;
+        for (size_type length = 1; length <= maniscalco::io::huffman_max_code_length; ++length)
+            kraft += ((std::uint64_t)lengthCount[length] << (maniscalco::io::huffman_max_code_length - length));
+        if (kraft > (1ull << maniscalco::io::huffman_max_code_length))
+            throw std::runtime_error("huffman: code lengths are over subscribed");
+
+        std::vector<std::uint32_t> nextCode(maniscalco::io::huffman_max_code_length + 1, 0);
+        std::uint32_t code = 0;
+        for (size_type length = 1; length <= maniscalco::io::huffman_max_code_length; ++length)
+        {
+            code = ((code + lengthCount[length - 1]) << 1);
+            nextCode[length] = code;
+        }
+
+        std::vector<std::uint32_t> codes(codeLengths.size(), 0);
+        for (std::size_t symbol = 0; symbol < codeLengths.size(); ++symbol)
+            if (auto length = codeLengths[symbol]; length > 0)
+                codes[symbol] = nextCode[length]++;
+        return codes;
+    }
+
+
+    //=========================================================================
+    void validate_symbol_count
+    (
+        std::size_t symbolCount
+    )
+    {
+        if (symbolCount > (1ull << 16))
+            throw std::runtime_error("huffman: at most 65536 symbols are supported");
+    }
+
+} // namespace
+
+
+//=============================================================================
+std::vector<std::uint8_t> maniscalco::io::make_huffman_code_lengths
+(
+    std::span<std::uint64_t const> frequencies,
+    std::int64_t maxCodeLength
+)
+{
+    if ((maxCodeLength < 1) || (maxCodeLength > huffman_max_code_length))
+        throw std::runtime_error("make_huffman_code_lengths: invalid maximum code length");
+    validate_symbol_count(frequencies.size());
+
+    std::vector<std::uint8_t> codeLengths(frequencies.size(), 0);
+
+    // used symbols sorted by ascending frequency
+    std::vector<std::uint32_t> symbols;
+    for (std::size_t symbol = 0; symbol < frequencies.size(); ++symbol)
+        if (frequencies[symbol] > 0)
+            symbols.push_back((std::uint32_t)symbol);
+    std::stable_sort(symbols.begin(), symbols.end(),
+            [&](auto a, auto b){return (frequencies[a] < frequencies[b]);});
+
+    size_type const leafCount = symbols.size();
+    if (leafCount == 0)
+        return codeLengths;
+    if (leafCount == 1)
+    {
+        codeLengths[symbols[0]] = 1;
+        return codeLengths;
+    }
+    if (leafCount > (1ll << maxCodeLength))
+        throw std::runtime_error("make_huffman_code_lengths: too many symbols for maximum code length");
+
+    // two queue huffman construction.  leaves are [0, leafCount) and internal
+    // nodes are created in order of increasing weight at [leafCount, 2 * leafCount - 1)
+    std::vector<std::uint64_t> weight(leafCount * 2 - 1);
+    std::vector<size_type> parent(leafCount * 2 - 1, 0);
+    for (size_type i = 0; i < leafCount; ++i)
+        weight[i] = frequencies[symbols[i]];
+    size_type nextLeaf = 0;
+    size_type nextInternal = leafCount;
+    auto take_smallest = [&](size_type endInternal)
+            {
+                if ((nextLeaf < leafCount) && ((nextInternal >= endInternal) || (weight[nextLeaf] <= weight[nextInternal])))
+                    return nextLeaf++;
+                return nextInternal++;
+            };
+    for (size_type node = leafCount; node < (leafCount * 2 - 1); ++node)
+    {
+        auto a = take_smallest(node);
+        auto b = take_smallest(node);
+        weight[node] = (weight[a] + weight[b]);
+        parent[a] = parent[b] = node;
+    }
+
+    // parents always follow their children so depths resolve root first
+    std::vector<size_type> depth(leafCount * 2 - 1, 0);
+    std::vector<size_type> lengthCount(leafCount + 1, 0);
+    for (auto node = (leafCount * 2 - 3); node >= 0; --node)
+        depth[node] = depth[parent[node]] + 1;
+    size_type maxDepth = 0;
+    for (size_type i = 0; i < leafCount; ++i)
+    {
+        ++lengthCount[depth[i]];
+        maxDepth = std::max(maxDepth, depth[i]);
+    }
+
+    // limit lengths to maxCodeLength (JPEG annex K.3 adjustment)
+    for (auto length = maxDepth; length > maxCodeLength; --length)
+    {
+        while (lengthCount[length] > 0)
+        {
+            auto shorter = length - 2;
+            while (lengthCount[shorter] == 0)
+                --shorter;
+            lengthCount[length] -= 2;
+            lengthCount[length - 1] += 1;
+            lengthCount[shorter + 1] += 2;
+            lengthCount[shorter] -= 1;
+        }
+    }
+
+    // shortest codes to the most frequent symbols
+    auto symbol = symbols.rbegin();
+    for (size_type length = 1; length <= std::min(maxDepth, maxCodeLength); ++length)
+        for (auto i = 0; i < lengthCount[length]; ++i)
+            codeLengths[*symbol++] = (std::uint8_t)length;
+    return codeLengths;
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+maniscalco::io::huffman_encoder<S>::huffman_encoder
+(
+    configuration_type const & configuration
+)
+{
+    validate_symbol_count(configuration.codeLengths_.size());
+    auto codes = make_canonical_codes(configuration.codeLengths_);
+    codes_.resize(codes.size());
+    for (std::size_t symbol = 0; symbol < codes.size(); ++symbol)
+    {
+        auto length = configuration.codeLengths_[symbol];
+        codes_[symbol].length_ = length;
+        codes_[symbol].code_ = (S == stream_direction::forward) ? codes[symbol] : reverse_bits(codes[symbol], length);
+    }
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+void maniscalco::io::huffman_encoder<S>::encode_n
+(
+    // gather codes into 64 bits at a time to reduce the number of pushes
+    stream_type & stream,
+    std::span<symbol_type const> symbols
+) const
+{
+    std::uint64_t accumulator = 0;
+    size_type accumulatorSize = 0;
+    for (auto symbol : symbols)
+    {
+        auto const & entry = codes_[symbol];
+        if ((accumulatorSize + entry.length_) > 64)
+        {
+            stream.push(accumulator, accumulatorSize);
+            accumulator = 0;
+            accumulatorSize = 0;
+        }
+        if constexpr (S == stream_direction::forward)
+            accumulator = ((accumulator << entry.length_) | entry.code_);
+        else
+            accumulator |= ((std::uint64_t)entry.code_ << accumulatorSize);
+        accumulatorSize += entry.length_;
+    }
+    if (accumulatorSize > 0)
+        stream.push(accumulator, accumulatorSize);
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+maniscalco::io::huffman_decoder<S>::huffman_decoder
+(
+    configuration_type const & configuration
+)
+{
+    auto const & codeLengths = configuration.codeLengths_;
+    validate_symbol_count(codeLengths.size());
+    auto codes = make_canonical_codes(codeLengths);
+
+    maxCodeLength_ = *std::max_element(codeLengths.begin(), codeLengths.end(),
+            [](auto a, auto b){return (a < b);});
+    if (maxCodeLength_ == 0)
+        throw std::runtime_error("huffman_decoder: no symbols have a code");
+    rootTableBits_ = std::clamp(configuration.rootTableBits_, (size_type)1, maxCodeLength_);
+
+    // bit at a time canonical decoding state
+    lengthCount_.assign(maxCodeLength_ + 1, 0);
+    for (auto length : codeLengths)
+        ++lengthCount_[length];
+    lengthCount_[0] = 0;
+    std::vector<std::int32_t> offset(maxCodeLength_ + 2, 0);
+    for (size_type length = 1; length <= maxCodeLength_; ++length)
+        offset[length + 1] = offset[length] + lengthCount_[length];
+    sortedSymbols_.resize(offset[maxCodeLength_ + 1]);
+    for (std::size_t symbol = 0; symbol < codeLengths.size(); ++symbol)
+        if (auto length = codeLengths[symbol]; length > 0)
+            sortedSymbols_[offset[length]++] = (symbol_type)symbol;
+
+    // codes as they appear in the stream.  for reverse streams the first bit
+    // of each code is the least significant bit of peek().
+    auto stream_code = [&](auto symbol)
+            {
+                return (S == stream_direction::forward) ? codes[symbol] : reverse_bits(codes[symbol], codeLengths[symbol]);
+            };
+    auto root_prefix = [&](std::uint32_t code, size_type length) -> size_type
+            {
+                if constexpr (S == stream_direction::forward)
+                    return (code >> (length - rootTableBits_));
+                else
+                    return (code & ((1u << rootTableBits_) - 1));
+            };
+
+    // root table entries for short codes.  each code fills every entry which
+    // starts with that code
+    rootTable_.assign(1ull << rootTableBits_, table_entry{0, 0, 0});
+    for (std::size_t symbol = 0; symbol < codeLengths.size(); ++symbol)
+    {
+        size_type length = codeLengths[symbol];
+        if ((length == 0) || (length > rootTableBits_))
+            continue;
+        auto code = stream_code(symbol);
+        table_entry entry{(std::uint32_t)symbol, (std::uint8_t)length, 0};
+        auto fillCount = (1ull << (rootTableBits_ - length));
+        for (std::uint64_t i = 0; i < fillCount; ++i)
+        {
+            if constexpr (S == stream_direction::forward)
+                rootTable_[((std::uint64_t)code << (rootTableBits_ - length)) + i] = entry;
+            else
+                rootTable_[code | (i << length)] = entry;
+        }
+    }
+
+    // sub tables for long codes.  each root prefix gets a sub table wide
+    // enough for the longest code sharing that prefix.
+    for (std::size_t symbol = 0; symbol < codeLengths.size(); ++symbol)
+    {
+        size_type length = codeLengths[symbol];
+        if (length > rootTableBits_)
+        {
+            auto & link = rootTable_[root_prefix(stream_code(symbol), length)];
+            link.subTableBits_ = std::max<std::uint8_t>(link.subTableBits_, length - rootTableBits_);
+        }
+    }
+    std::uint32_t subTableSize = 0;
+    for (auto & link : rootTable_)
+    {
+        if (link.subTableBits_ > 0)
+        {
+            link.value_ = subTableSize;
+            subTableSize += (1u << link.subTableBits_);
+        }
+    }
+    subTable_.assign(subTableSize, table_entry{0, 0, 0});
+    for (std::size_t symbol = 0; symbol < codeLengths.size(); ++symbol)
+    {
+        size_type length = codeLengths[symbol];
+        if (length <= rootTableBits_)
+            continue;
+        auto code = stream_code(symbol);
+        auto const & link = rootTable_[root_prefix(code, length)];
+        auto suffixLength = (length - rootTableBits_);
+        auto * subTable = subTable_.data() + link.value_;
+        table_entry entry{(std::uint32_t)symbol, (std::uint8_t)length, 0};
+        auto fillCount = (1ull << (link.subTableBits_ - suffixLength));
+        for (std::uint64_t i = 0; i < fillCount; ++i)
+        {
+            if constexpr (S == stream_direction::forward)
+                subTable[((std::uint64_t)(code & ((1u << suffixLength) - 1)) << (link.subTableBits_ - suffixLength)) + i] = entry;
+            else
+                subTable[(code >> rootTableBits_) | (i << suffixLength)] = entry;
+        }
+    }
+
+    // pairs of root table codes which together fit within rootTableBits_
+    if (configuration.multiSymbol_)
+    {
+        auto rootMask = ((1ull << rootTableBits_) - 1);
+        multiSymbolTable_.assign(rootTable_.size(), multi_symbol_entry{{0, 0}, 0, 0});
+        for (std::uint64_t i = 0; i < rootTable_.size(); ++i)
+        {
+            auto const & first = rootTable_[i];
+            if (first.length_ == 0)
+                continue;
+            auto & entry = multiSymbolTable_[i];
+            entry = {{(symbol_type)first.value_, 0}, 1, first.length_};
+            auto next = (S == stream_direction::forward) ? ((i << first.length_) & rootMask) : (i >> first.length_);
+            auto const & second = rootTable_[next];
+            if ((second.length_ > 0) && (second.length_ <= (rootTableBits_ - first.length_)))
+            {
+                entry.symbol_[1] = (symbol_type)second.value_;
+                entry.count_ = 2;
+                entry.length_ += second.length_;
+            }
+        }
+    }
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+void maniscalco::io::huffman_decoder<S>::decode_n
+(
+    stream_type & stream,
+    std::span<symbol_type> symbols
+) const
+{
+    std::size_t i = 0;
+    if (!multiSymbolTable_.empty())
+    {
+        while ((i + 1) < symbols.size())
+        {
+            auto bits = stream.peek(maxCodeLength_);
+            if (!bits)
+            {
+                symbols[i++] = decode_slow(stream);
+                continue;
+            }
+            auto const & entry = multiSymbolTable_[root_index(*bits)];
+            if (entry.count_ == 0)
+            {
+                symbols[i++] = decode(stream);
+                continue;
+            }
+            symbols[i] = entry.symbol_[0];
+            symbols[i + 1] = entry.symbol_[1];
+            i += entry.count_;
+            stream.discard(entry.length_);
+        }
+    }
+    for (; i < symbols.size(); ++i)
+        symbols[i] = decode(stream);
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+auto maniscalco::io::huffman_decoder<S>::decode_slow
+(
+    // canonical decode one bit at a time.  used when fewer than maxCodeLength_
+    // bits remain in the current packet so codes may span packets.
+    stream_type & stream
+) const -> symbol_type
+{
+    std::int32_t code = 0;
+    std::int32_t first = 0;
+    std::int32_t index = 0;
+    for (size_type length = 1; length <= maxCodeLength_; ++length)
+    {
+        code |= (std::int32_t)stream.pop(1);
+        auto count = lengthCount_[length];
+        if ((code - first) < count)
+            return sortedSymbols_[index + (code - first)];
+        index += count;
+        first += count;
+        first <<= 1;
+        code <<= 1;
+    }
+    throw_invalid_code();
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+void maniscalco::io::huffman_decoder<S>::throw_invalid_code
+(
+) const
+{
+    throw std::runtime_error("huffman_decoder: invalid code");
+}
+
+
+//=============================================================================
+namespace maniscalco::io
+{
+    template class huffman_encoder<stream_direction::forward>;
+    template class huffman_encoder<stream_direction::reverse>;
+    template class huffman_decoder<stream_direction::forward>;
+    template class huffman_decoder<stream_direction::reverse>;
+
+} // maniscalco
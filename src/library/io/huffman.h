@@ -0,0 +1,245 @@
+#pragma once
+
+#include "./stream_direction.h"
+#include "./push_stream.h"
+#include "./pop_stream.h"
+
+#include <cstdint>
+#include <vector>
+#include <span>
+#include <array>
+
+
+namespace maniscalco::io
+{
+
+    static std::int64_t constexpr huffman_max_code_length = 24;
+
+    // returns length limited huffman code lengths for the given symbol frequencies.
+    // symbols with a frequency of zero are assigned a code length of zero.
+    std::vector<std::uint8_t> make_huffman_code_lengths
+    (
+        std::span<std::uint64_t const>,
+        std::int64_t = 15
+    );
+
+
+    // canonical huffman encoder.  codes are assigned in (length, symbol) order.
+    // for reverse streams codes are pushed bit reversed so that the decoder
+    // always sees the first bit of each code at a fixed position.
+    template <stream_direction S>
+    class huffman_encoder final
+    {
+    public:
+
+        using symbol_type = std::uint16_t;
+        using size_type = std::int64_t;
+        using stream_type = push_stream<S>;
+
+        struct configuration_type
+        {
+            std::vector<std::uint8_t> codeLengths_;
+        };
+
+        huffman_encoder(configuration_type const &);
+
+        huffman_encoder(huffman_encoder const &) = default;
+        huffman_encoder & operator = (huffman_encoder const &) = default;
+
+        ~huffman_encoder() = default;
+
+        // symbol must have a non zero code length
+        void encode
+        (
+            stream_type &,
+            symbol_type
+        ) const;
+
+        void encode_n
+        (
+            stream_type &,
+            std::span<symbol_type const>
+        ) const;
+
+    private:
+
+        struct code_entry
+        {
+            std::uint32_t code_;
+            std::uint32_t length_;
+        };
+
+        std::vector<code_entry> codes_;
+
+    }; // class huffman_encoder
+
+
+    // canonical huffman decoder.  codes are resolved with a root lookup table
+    // indexed by the next rootTableBits_ bits of the stream (via peek) and a
+    // second level table for codes that are longer than rootTableBits_.
+    // when multiSymbol_ is set decode_n also uses a table which resolves two
+    // short codes per lookup.  where peek can not supply maxCodeLength bits
+    // (near the end of a packet) codes are decoded a bit at a time.
+    template <stream_direction S>
+    class huffman_decoder final
+    {
+    public:
+
+        using symbol_type = std::uint16_t;
+        using size_type = std::int64_t;
+        using stream_type = pop_stream<S>;
+
+        static size_type constexpr default_root_table_bits = 11;
+
+        struct configuration_type
+        {
+            std::vector<std::uint8_t> codeLengths_;
+            size_type rootTableBits_{default_root_table_bits};
+            bool multiSymbol_{false};
+        };
+
+        huffman_decoder(configuration_type const &);
+
+        huffman_decoder(huffman_decoder const &) = default;
+        huffman_decoder & operator = (huffman_decoder const &) = default;
+
+        ~huffman_decoder() = default;
+
+        symbol_type decode
+        (
+            stream_type &
+        ) const;
+
+        void decode_n
+        (
+            stream_type &,
+            std::span<symbol_type>
+        ) const;
+
+    private:
+
+        struct table_entry
+        {
+            std::uint32_t value_;           // symbol or, for links, offset of the sub table
+            std::uint8_t length_;           // code length.  zero for links and invalid codes
+            std::uint8_t subTableBits_;     // non zero for links to a sub table
+        };
+
+        struct multi_symbol_entry
+        {
+            std::array<symbol_type, 2> symbol_;
+            std::uint8_t count_;            // zero when the first code is not in the root table
+            std::uint8_t length_;           // total length of all codes in this entry
+        };
+
+        size_type root_index
+        (
+            std::uint64_t
+        ) const;
+
+        size_type sub_table_index
+        (
+            std::uint64_t,
+            size_type
+        ) const;
+
+        symbol_type decode_slow
+        (
+            stream_type &
+        ) const;
+
+        [[noreturn]] void throw_invalid_code() const;
+
+        size_type maxCodeLength_{0};
+
+        size_type rootTableBits_{0};
+
+        std::vector<table_entry> rootTable_;
+
+        std::vector<table_entry> subTable_;
+
+        std::vector<multi_symbol_entry> multiSymbolTable_;
+
+        // canonical decoding state for the bit at a time path
+        std::vector<std::int32_t> lengthCount_;
+
+        std::vector<symbol_type> sortedSymbols_;
+
+    }; // class huffman_decoder
+
+
+    using forward_huffman_encoder = huffman_encoder<stream_direction::forward>;
+    using reverse_huffman_encoder = huffman_encoder<stream_direction::reverse>;
+    using forward_huffman_decoder = huffman_decoder<stream_direction::forward>;
+    using reverse_huffman_decoder = huffman_decoder<stream_direction::reverse>;
+
+} // namespace maniscalco::io
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+inline void maniscalco::io::huffman_encoder<S>::encode
+(
+    stream_type & stream,
+    symbol_type symbol
+) const
+{
+    auto const & entry = codes_[symbol];
+    stream.push(entry.code_, entry.length_);
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+inline auto maniscalco::io::huffman_decoder<S>::root_index
+(
+    // bits is the result of peek(maxCodeLength_)
+    std::uint64_t bits
+) const -> size_type
+{
+    if constexpr (S == stream_direction::forward)
+        return (bits >> (maxCodeLength_ - rootTableBits_));
+    else
+        return (bits & ((1ull << rootTableBits_) - 1));
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+inline auto maniscalco::io::huffman_decoder<S>::sub_table_index
+(
+    // bits is the result of peek(maxCodeLength_)
+    std::uint64_t bits,
+    size_type subTableBits
+) const -> size_type
+{
+    if constexpr (S == stream_direction::forward)
+        return ((bits >> (maxCodeLength_ - rootTableBits_ - subTableBits)) & ((1ull << subTableBits) - 1));
+    else
+        return ((bits >> rootTableBits_) & ((1ull << subTableBits) - 1));
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+inline auto maniscalco::io::huffman_decoder<S>::decode
+(
+    stream_type & stream
+) const -> symbol_type
+{
+    auto bits = stream.peek(maxCodeLength_);
+    if (!bits)
+        return decode_slow(stream);
+
+    auto entry = rootTable_[root_index(*bits)];
+    if (entry.length_ == 0)
+    {
+        if (entry.subTableBits_ == 0)
+            throw_invalid_code();
+        entry = subTable_[entry.value_ + sub_table_index(*bits, entry.subTableBits_)];
+        if (entry.length_ == 0)
+            throw_invalid_code();
+    }
+    stream.discard(entry.length_);
+    return entry.value_;
+}
@@ -0,0 +1,148 @@
+#include "./huge_pages.h"
+
+#include <array>
+#include <stdexcept>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+    #include <sys/syscall.h>
+    #include <linux/mempolicy.h>
+#endif
+
+
+namespace
+{
+
+    using size_type = maniscalco::huge_pages::size_type;
+    using element_type = maniscalco::huge_pages::element_type;
+
+    static size_type constexpr small_page_size = 4096;
+
+
+    //=========================================================================
+    element_type * map_hugetlb
+    (
+        // returns nullptr when no reserved huge pages are available
+        size_type size
+    )
+    {
+        #if defined(MAP_HUGETLB)
+            int flags = (MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB);
+            #if defined(MAP_HUGE_2MB)
+                flags |= MAP_HUGE_2MB;
+            #endif
+            auto address = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+            if (address != MAP_FAILED)
+                return (element_type *)address;
+        #endif
+        return nullptr;
+    }
+
+
+    //=========================================================================
+    element_type * map_aligned
+    (
+        // map 'size' bytes aligned to a huge page boundary so that the kernel
+        // can back the whole range with transparent huge pages
+        size_type size
+    )
+    {
+        auto reserved = (size + maniscalco::huge_pages::page_size);
+        auto address = ::mmap(nullptr, reserved, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (address == MAP_FAILED)
+            throw std::runtime_error("huge_pages: failed to map memory");
+        auto begin = (element_type *)address;
+        auto aligned = (element_type *)((((std::uintptr_t)begin + maniscalco::huge_pages::page_size - 1) /
+                maniscalco::huge_pages::page_size) * maniscalco::huge_pages::page_size);
+        if (auto head = (aligned - begin); head > 0)
+            ::munmap(begin, head);
+        if (auto tail = ((begin + reserved) - (aligned + size)); tail > 0)
+            ::munmap(aligned + size, tail);
+        #if defined(MADV_HUGEPAGE)
+            ::madvise(aligned, size, MADV_HUGEPAGE);
+        #endif
+        return aligned;
+    }
+
+
+    //=========================================================================
+    void bind_to_node
+    (
+        // prefer 'node' for the pages of the range.  must precede the first
+        // touch of the pages.  best effort - failure leaves placement to the
+        // kernel.
+        element_type * address,
+        size_type size,
+        std::int32_t node
+    )
+    {
+        #if defined(__linux__) && defined(SYS_mbind)
+            static auto constexpr bits_per_mask = (sizeof(unsigned long) * 8);
+            std::array<unsigned long, 16> nodeMask{};
+            if ((node < 0) || (node >= (std::int32_t)(nodeMask.size() * bits_per_mask)))
+                return;
+            nodeMask[node / bits_per_mask] |= (1ul << (node % bits_per_mask));
+            ::syscall(SYS_mbind, address, size, MPOL_PREFERRED, nodeMask.data(), (nodeMask.size() * bits_per_mask) + 1, 0);
+        #else
+            (void)address; (void)size; (void)node;
+        #endif
+    }
+
+} // namespace
+
+
+//=============================================================================
+auto maniscalco::huge_pages::allocate
+(
+    // numaNode is a node number, local_node or any_node
+    size_type size,
+    std::int32_t numaNode,
+    bool prefault
+) -> element_type *
+{
+    size = mapped_size(size);
+    auto address = map_hugetlb(size);
+    if (address == nullptr)
+        address = map_aligned(size);
+    if (numaNode == local_node)
+        numaNode = current_node();
+    if (numaNode != any_node)
+        bind_to_node(address, size, numaNode);
+    if (prefault)
+    {
+        // one write per small page also covers transparent huge pages which
+        // the kernel declined to provide
+        for (size_type offset = 0; offset < size; offset += small_page_size)
+            ((element_type volatile *)address)[offset] = 0;
+    }
+    return address;
+}
+
+
+//=============================================================================
+void maniscalco::huge_pages::deallocate
+(
+    element_type * address,
+    size_type size
+)
+{
+    if (address != nullptr)
+        ::munmap(address, mapped_size(size));
+}
+
+
+//=============================================================================
+std::int32_t maniscalco::huge_pages::current_node
+(
+)
+{
+    #if defined(__linux__) && defined(SYS_getcpu)
+        unsigned cpu = 0;
+        unsigned node = 0;
+        if (::syscall(SYS_getcpu, &cpu, &node, nullptr) == 0)
+            return (std::int32_t)node;
+    #endif
+    return 0;
+}
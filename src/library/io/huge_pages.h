@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+
+
+namespace maniscalco
+{
+
+    // anonymous memory backed by 2MB huge pages.  MAP_HUGETLB is used when
+    // huge pages have been reserved (vm.nr_hugepages).  otherwise the mapping
+    // is 2MB aligned and transparent huge pages are requested with
+    // madvise(MADV_HUGEPAGE).  the memory is zero filled.
+    //
+    // pages are placed on the requested numa node (MPOL_PREFERRED) before
+    // they are first touched.  a strict binding is not used because a fault
+    // on a node without free huge pages would raise SIGBUS rather than fall
+    // back to another node.
+    struct huge_pages
+    {
+        using size_type = std::int64_t;
+        using element_type = std::uint8_t;
+
+        static size_type constexpr page_size = (1 << 21);
+
+        // the node of the calling thread at the time of allocation
+        static std::int32_t constexpr local_node = -1;
+
+        // placement is left to the kernel
+        static std::int32_t constexpr any_node = -2;
+
+        // 'size' rounded up to a whole number of huge pages
+        static size_type mapped_size
+        (
+            size_type size
+        )
+        {
+            return (((size + page_size - 1) / page_size) * page_size);
+        }
+
+        // returns mapped_size(size) bytes.  when 'prefault' is set every page
+        // is touched before returning so that no faults are taken later.
+        static element_type * allocate
+        (
+            size_type,
+            std::int32_t = local_node,
+            bool = false
+        );
+
+        // 'size' as passed to allocate
+        static void deallocate
+        (
+            element_type *,
+            size_type
+        );
+
+        // numa node of the cpu on which the calling thread is running
+        // (0 where this is unknown)
+        static std::int32_t current_node();
+    };
+
+} // namespace maniscalco
@@ -0,0 +1,423 @@
+#include "./mmap_file.h"
+#include "./packet_record.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace
+{
+
+    using size_type = std::int64_t;
+    using record_header_type = maniscalco::io::packet_record::header_type;
+
+
+    //=========================================================================
+    size_type page_size
+    (
+    )
+    {
+        static size_type const pageSize = ::sysconf(_SC_PAGESIZE);
+        return pageSize;
+    }
+
+
+    //=========================================================================
+    size_type round_up_to_page
+    (
+        size_type size
+    )
+    {
+        return ((size + page_size() - 1) & ~(page_size() - 1));
+    }
+
+
+    //=========================================================================
+    class mapping final
+    {
+    public:
+
+        // reference counted read only mapping of an entire file followed by 
+        // one zero filled guard page so that pop_stream's 8 byte reads beyond
+        // the final packet are always valid
+        mapping
+        (
+            int fd,
+            size_type fileSize
+        ):
+            fileSize_(fileSize),
+            reservedSize_(round_up_to_page(fileSize) + page_size())
+        {
+            auto reserved = ::mmap(nullptr, reservedSize_, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (reserved == MAP_FAILED)
+                throw std::runtime_error("mmap_file_input_handler: failed to reserve address space");
+            if (fileSize_ > 0)
+            {
+                if (::mmap(reserved, fileSize_, PROT_READ, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED)
+                {
+                    ::munmap(reserved, reservedSize_);
+                    throw std::runtime_error("mmap_file_input_handler: failed to map file");
+                }
+                ::madvise(reserved, fileSize_, MADV_SEQUENTIAL);
+            }
+            data_ = reinterpret_cast<std::uint8_t *>(reserved);
+        }
+
+        void add_reference()
+        {
+            referenceCount_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        void remove_reference()
+        {
+            if (referenceCount_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                ::munmap(data_, reservedSize_);
+                delete this;
+            }
+        }
+
+        std::uint8_t * data() const
+        {
+            return data_;
+        }
+
+        size_type size() const
+        {
+            return fileSize_;
+        }
+
+    private:
+
+        size_type const fileSize_;
+
+        size_type const reservedSize_;
+
+        std::uint8_t * data_;
+
+        std::atomic<std::int64_t> referenceCount_{1};
+    };
+
+} // namespace
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+class maniscalco::io::mmap_file_output_handler<S>::state final
+{
+public:
+
+    state
+    (
+        configuration_type const & configuration
+    ):
+        chunkSize_(round_up_to_page(std::max<size_type>(configuration.chunkSize_, page_size())))
+    {
+        fd_ = ::open(configuration.path_.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd_ < 0)
+            throw std::runtime_error("mmap_file_output_handler: failed to open " + configuration.path_);
+    }
+
+    ~state()
+    {
+        // errors can only be reported by an explicit close()
+        try
+        {
+            close();
+        }
+        catch (...)
+        {
+        }
+    }
+
+    void write
+    (
+        packet_type const & packet
+    )
+    {
+        if (fd_ < 0)
+            throw std::runtime_error("mmap_file_output_handler: write after close");
+        auto [source, numBytes] = packet_record::bytes(packet);
+        auto header = (record_header_type)packet.size();
+        reserve(sizeof(header) + numBytes);
+        auto destination = window_ + (writeOffset_ - windowOffset_);
+        std::memcpy(destination, &header, sizeof(header));
+        std::memcpy(destination + sizeof(header), source, numBytes);
+        writeOffset_ += (sizeof(header) + numBytes);
+    }
+
+    void close()
+    {
+        if (fd_ >= 0)
+        {
+            // trim the zero padding of the last chunk.  left in place the
+            // reader would take it for the end of the stream.
+            unmap_window();
+            auto result = ::ftruncate(fd_, writeOffset_);
+            auto error = errno;
+            ::close(fd_);
+            fd_ = -1;
+            if (result != 0)
+                throw std::system_error(error, std::generic_category(), "mmap_file_output_handler: failed to truncate file");
+        }
+    }
+
+    size_type size() const
+    {
+        return writeOffset_;
+    }
+
+private:
+
+    void reserve
+    (
+        // ensure that the current window can hold the next 'size' bytes
+        // growing the file and remapping the window in chunks as needed
+        size_type size
+    )
+    {
+        if ((writeOffset_ + size) <= (windowOffset_ + windowSize_))
+            return;
+        unmap_window();
+        windowOffset_ = (writeOffset_ & ~(page_size() - 1));
+        windowSize_ = std::max(chunkSize_, round_up_to_page(writeOffset_ - windowOffset_ + size));
+        if ((windowOffset_ + windowSize_) > fileSize_)
+        {
+            fileSize_ = (windowOffset_ + windowSize_);
+            if (::ftruncate(fd_, fileSize_) != 0)
+                throw std::runtime_error("mmap_file_output_handler: failed to grow file");
+        }
+        auto window = ::mmap(nullptr, windowSize_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, windowOffset_);
+        if (window == MAP_FAILED)
+        {
+            windowSize_ = 0;
+            throw std::runtime_error("mmap_file_output_handler: failed to map file");
+        }
+        window_ = reinterpret_cast<std::uint8_t *>(window);
+    }
+
+    void unmap_window()
+    {
+        if (window_ != nullptr)
+            ::munmap(window_, windowSize_);
+        window_ = nullptr;
+        windowSize_ = 0;
+    }
+
+    size_type const chunkSize_;
+
+    int fd_{-1};
+
+    size_type fileSize_{0};
+
+    size_type writeOffset_{0};
+
+    std::uint8_t * window_{nullptr};
+
+    size_type windowOffset_{0};
+
+    size_type windowSize_{0};
+
+}; // class mmap_file_output_handler<S>::state
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+class maniscalco::io::mmap_file_input_handler<S>::state final
+{
+public:
+
+    state
+    (
+        configuration_type const & configuration
+    ):
+        packetIndex_(configuration.packetIndex_)
+    {
+        auto fd = ::open(configuration.path_.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("mmap_file_input_handler: failed to open " + configuration.path_);
+        struct stat fileStatus;
+        if (::fstat(fd, &fileStatus) != 0)
+        {
+            ::close(fd);
+            throw std::runtime_error("mmap_file_input_handler: failed to stat " + configuration.path_);
+        }
+        try
+        {
+            mapping_ = new mapping(fd, fileStatus.st_size);
+        }
+        catch (...)
+        {
+            ::close(fd);
+            throw;
+        }
+        ::close(fd); // mapping remains valid after close
+    }
+
+    ~state()
+    {
+        mapping_->remove_reference();
+    }
+
+    packet_type read()
+    {
+        if (empty())
+            return {};
+        return read_record();
+    }
+
+    packet_type read
+    (
+        size_type packetNumber
+    )
+    {
+        if (!packetIndex_)
+            throw std::runtime_error("mmap_file_input_handler: random access requires a packet index");
+        if ((packetNumber < 0) || (packetNumber >= packetIndex_->packet_count()))
+            return {};
+        readOffset_ = packetIndex_->record_offset(packetNumber);
+        if (empty())
+            throw std::runtime_error("mmap_file_input_handler: packet index does not match file");
+        return read_record();
+    }
+
+    bool empty() const
+    {
+        return ((readOffset_ + (size_type)sizeof(record_header_type)) > mapping_->size());
+    }
+
+private:
+
+    packet_type read_record()
+    {
+        record_header_type numBits;
+        std::memcpy(&numBits, mapping_->data() + readOffset_, sizeof(numBits));
+        auto numBytes = packet_record::byte_count(numBits);
+        if ((readOffset_ + (size_type)sizeof(numBits) + numBytes) > mapping_->size())
+            throw std::runtime_error("mmap_file_input_handler: truncated record");
+        auto data = mapping_->data() + readOffset_ + sizeof(numBits);
+        readOffset_ += (sizeof(numBits) + numBytes);
+        // seat packet directly over the mapped pages.  the mapping is 
+        // unmapped once the last packet referencing it is released.
+        mapping_->add_reference();
+        return packet_record::make_packet<S>(buffer(data, numBytes, [m = mapping_](auto *){m->remove_reference();}), numBits);
+    }
+
+    std::shared_ptr<packet_index const> packetIndex_;
+
+    mapping * mapping_{nullptr};
+
+    size_type readOffset_{0};
+
+}; // class mmap_file_input_handler<S>::state
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+maniscalco::io::mmap_file_output_handler<S>::mmap_file_output_handler
+(
+    configuration_type const & configuration
+):
+    state_(std::make_shared<state>(configuration))
+{
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+void maniscalco::io::mmap_file_output_handler<S>::operator()
+(
+    packet_type packet
+)
+{
+    state_->write(packet);
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+void maniscalco::io::mmap_file_output_handler<S>::close
+(
+    // unmap and truncate file to the size actually written
+)
+{
+    state_->close();
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+auto maniscalco::io::mmap_file_output_handler<S>::size
+(
+    // returns number of bytes written to file
+) const -> size_type
+{
+    return state_->size();
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+maniscalco::io::mmap_file_input_handler<S>::mmap_file_input_handler
+(
+    configuration_type const & configuration
+):
+    state_(std::make_shared<state>(configuration))
+{
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+auto maniscalco::io::mmap_file_input_handler<S>::operator()
+(
+    // returns next packet seated over the mapped file.  
+    // returns an empty packet once the end of file is reached.
+) -> packet_type
+{
+    return state_->read();
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+auto maniscalco::io::mmap_file_input_handler<S>::operator()
+(
+    // returns the packet numbered 'packetNumber' using the packet index.
+    // subsequent sequential reads continue from the following packet.
+    // returns an empty packet if 'packetNumber' is beyond the last packet.
+    size_type packetNumber
+) -> packet_type
+{
+    return state_->read(packetNumber);
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+bool maniscalco::io::mmap_file_input_handler<S>::empty
+(
+) const
+{
+    return state_->empty();
+}
+
+
+//=============================================================================
+namespace maniscalco::io
+{
+    template class mmap_file_output_handler<stream_direction::forward>;
+    template class mmap_file_output_handler<stream_direction::reverse>;
+    template class mmap_file_input_handler<stream_direction::forward>;
+    template class mmap_file_input_handler<stream_direction::reverse>;
+
+} // maniscalco
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "./buffer.h"
+#include "./stream_direction.h"
+#include "./stream_packet.h"
+#include "./packet_index.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+
+namespace maniscalco::io
+{
+
+    // files are written as a sequence of packet_record (see packet_record.h)
+
+    template <stream_direction S>
+    class mmap_file_output_handler final
+    {
+    public:
+
+        using size_type = std::int64_t;
+        using packet_type = stream_packet<S>;
+
+        static size_type constexpr default_chunk_size = (1ll << 26);
+
+        struct configuration_type 
+        {
+            std::string path_;
+            size_type chunkSize_{default_chunk_size};
+        };
+
+        mmap_file_output_handler(configuration_type const &);
+
+        // copies share the same underlying file
+        mmap_file_output_handler(mmap_file_output_handler const &) = default;
+        mmap_file_output_handler & operator = (mmap_file_output_handler const &) = default;
+
+        ~mmap_file_output_handler() = default;
+
+        void operator()
+        (
+            packet_type
+        );
+
+        // trims the file to the records written.  throws std::system_error
+        // if the file cannot be truncated.
+        void close();
+
+        size_type size() const;
+
+    private:
+
+        class state;
+
+        std::shared_ptr<state> state_;
+
+    }; // class mmap_file_output_handler
+
+
+    template <stream_direction S>
+    class mmap_file_input_handler final
+    {
+    public:
+
+        using size_type = std::int64_t;
+        using packet_type = stream_packet<S>;
+
+        struct configuration_type 
+        {
+            std::string path_;
+            // required for random access by packet number
+            std::shared_ptr<packet_index const> packetIndex_;
+        };
+
+        mmap_file_input_handler(configuration_type const &);
+
+        // copies share the same underlying mapping and read position
+        mmap_file_input_handler(mmap_file_input_handler const &) = default;
+        mmap_file_input_handler & operator = (mmap_file_input_handler const &) = default;
+
+        ~mmap_file_input_handler() = default;
+
+        packet_type operator()();
+
+        packet_type operator()
+        (
+            size_type
+        );
+
+        bool empty() const;
+
+    private:
+
+        class state;
+
+        std::shared_ptr<state> state_;
+
+    }; // class mmap_file_input_handler
+
+} // namespace maniscalco::io
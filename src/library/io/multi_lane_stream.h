@@ -0,0 +1,454 @@
+#pragma once
+
+#include "./buffer.h"
+#include "./stream_direction.h"
+#include "./stream_packet.h"
+#include "./packet_record.h"
+#include "./push_stream.h"
+#include "./pop_stream.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <array>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+
+
+namespace maniscalco::io
+{
+
+    // N independent lanes multiplexed into a single stream of packets.
+    // codes are distributed round robin across the lanes (or to a lane chosen
+    // by the caller) so that N accumulators are updated independently which
+    // exposes instruction level parallelism.  lanes may also be encoded and
+    // decoded on separate threads.
+    //
+    // container layout: every lane packet is preceded by a 32 bit lane tag
+    // packet holding the lane number.  packets of each lane appear in order.
+    struct lane_tag
+    {
+        using size_type = std::int64_t;
+        using tag_type = std::uint32_t;
+
+        static auto constexpr bits_per_byte = 8;
+        static size_type constexpr tag_size = (sizeof(tag_type) * bits_per_byte);
+
+        template <stream_direction S>
+        static stream_packet<S> make_packet
+        (
+            size_type lane
+        )
+        {
+            auto tag = endian_swap<std::endian::native, std::endian::big>((tag_type)lane);
+            buffer data(sizeof(tag));
+            std::memcpy(data.data(), &tag, sizeof(tag));
+            return packet_record::make_packet<S>(std::move(data), tag_size);
+        }
+
+        template <stream_direction S>
+        static size_type read
+        (
+            stream_packet<S> const & packet
+        )
+        {
+            if (packet.size() != tag_size)
+                throw std::runtime_error("lane_tag: invalid lane tag packet");
+            tag_type tag;
+            std::memcpy(&tag, packet_record::bytes(packet).first, sizeof(tag));
+            return endian_swap<std::endian::big, std::endian::native>(tag);
+        }
+    };
+
+
+    template <stream_direction S, std::size_t N>
+    class multi_lane_push_stream final
+    {
+    public:
+
+        static_assert(N > 0, "multi_lane_push_stream: at least one lane is required");
+
+        using code_type = typename push_stream<S>::code_type;
+        using size_type = typename push_stream<S>::size_type;
+        using packet_type = stream_packet<S>;
+        using buffer_allocation_handler = typename push_stream<S>::buffer_allocation_handler;
+        using buffer_output_handler = typename push_stream<S>::buffer_output_handler;
+
+        static size_type constexpr lane_count = N;
+
+        struct configuration_type
+        {
+            buffer_output_handler bufferOutputHandler_;
+            buffer_allocation_handler bufferAllocationHandler_;
+        };
+
+        multi_lane_push_stream(configuration_type const &);
+
+        multi_lane_push_stream(multi_lane_push_stream &&) = default;
+        multi_lane_push_stream & operator = (multi_lane_push_stream &&) = default;
+
+        multi_lane_push_stream(multi_lane_push_stream const &) = delete;
+        multi_lane_push_stream & operator = (multi_lane_push_stream const &) = delete;
+
+        ~multi_lane_push_stream() = default;
+
+        // push to the next lane in round robin order
+        void push
+        (
+            code_type,
+            size_type
+        );
+
+        void push_n
+        (
+            std::span<code_type const>,
+            size_type
+        );
+
+        // lanes may be pushed to directly and from separate threads
+        push_stream<S> & lane
+        (
+            size_type
+        );
+
+        size_type size() const;
+
+        void flush();
+
+    private:
+
+        struct mux
+        {
+            std::mutex mutex_;
+            buffer_output_handler bufferOutputHandler_;
+        };
+
+        std::array<push_stream<S>, N> lanes_;
+
+        size_type nextLane_{0};
+
+    }; // class multi_lane_push_stream
+
+
+    template <stream_direction S, std::size_t N>
+    class multi_lane_pop_stream final
+    {
+    public:
+
+        static_assert(N > 0, "multi_lane_pop_stream: at least one lane is required");
+
+        using code_type = typename pop_stream<S>::code_type;
+        using size_type = typename pop_stream<S>::size_type;
+        using packet_type = stream_packet<S>;
+        using input_handler = typename pop_stream<S>::input_handler;
+
+        static size_type constexpr lane_count = N;
+
+        struct configuration_type
+        {
+            input_handler inputHandler_;
+        };
+
+        multi_lane_pop_stream(configuration_type const &);
+
+        multi_lane_pop_stream(multi_lane_pop_stream &&) = default;
+        multi_lane_pop_stream & operator = (multi_lane_pop_stream &&) = default;
+
+        multi_lane_pop_stream(multi_lane_pop_stream const &) = delete;
+        multi_lane_pop_stream & operator = (multi_lane_pop_stream const &) = delete;
+
+        ~multi_lane_pop_stream() = default;
+
+        // pop from the next lane in round robin order
+        code_type pop
+        (
+            size_type
+        );
+
+        void pop_n
+        (
+            std::span<code_type>,
+            size_type
+        );
+
+        // lanes may be popped from directly and from separate threads
+        pop_stream<S> & lane
+        (
+            size_type
+        );
+
+        size_type size_consumed() const;
+
+    private:
+
+        // routes packets read from the container to the lane which requests
+        // them.  packets for other lanes are held until those lanes ask.
+        struct demux
+        {
+            packet_type next
+            (
+                size_type lane
+            )
+            {
+                std::lock_guard lock(mutex_);
+                if (!pending_[lane].empty())
+                {
+                    auto packet = std::move(pending_[lane].front());
+                    pending_[lane].pop_front();
+                    return packet;
+                }
+                while (true)
+                {
+                    auto tag = inputHandler_();
+                    if (tag.size() == 0)
+                        return {};
+                    auto tagLane = lane_tag::read(tag);
+                    if (tagLane >= lane_count)
+                        throw std::runtime_error("multi_lane_pop_stream: invalid lane");
+                    auto packet = inputHandler_();
+                    if (tagLane == lane)
+                        return packet;
+                    pending_[tagLane].emplace_back(std::move(packet));
+                }
+            }
+
+            std::mutex mutex_;
+            input_handler inputHandler_;
+            std::array<std::deque<packet_type>, N> pending_;
+        };
+
+        std::array<pop_stream<S>, N> lanes_;
+
+        size_type nextLane_{0};
+
+    }; // class multi_lane_pop_stream
+
+} // namespace maniscalco::io
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S, std::size_t N>
+maniscalco::io::multi_lane_push_stream<S, N>::multi_lane_push_stream
+(
+    configuration_type const & configuration
+)
+{
+    // lane handlers share the mux so that tag and packet are always adjacent
+    auto shared = std::make_shared<mux>();
+    shared->bufferOutputHandler_ = configuration.bufferOutputHandler_;
+    for (auto lane = 0ull; lane < N; ++lane)
+        lanes_[lane] = push_stream<S>({
+                .bufferOutputHandler_ = [shared, lane](auto packet)
+                        {
+                            std::lock_guard lock(shared->mutex_);
+                            shared->bufferOutputHandler_(lane_tag::make_packet<S>(lane));
+                            shared->bufferOutputHandler_(std::move(packet));
+                        },
+                .bufferAllocationHandler_ = configuration.bufferAllocationHandler_});
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S, std::size_t N>
+inline void maniscalco::io::multi_lane_push_stream<S, N>::push
+(
+    code_type code,
+    size_type codeSize
+)
+{
+    lanes_[nextLane_].push(code, codeSize);
+    if (++nextLane_ == lane_count)
+        nextLane_ = 0;
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S, std::size_t N>
+inline void maniscalco::io::multi_lane_push_stream<S, N>::push_n
+(
+    // codes are distributed round robin.  whole rounds gather as many codes
+    // as fit in 64 bits into a local accumulator per lane so that the N 
+    // accumulators are independent registers and each lane's push_stream is
+    // updated once per group rather than once per code.  bit exact with 
+    // pushing each code in turn.
+    std::span<code_type const> codes,
+    size_type codeSize
+)
+{
+    static auto constexpr bits_per_word = 64;
+
+    if (codeSize <= 0)
+        return;
+    if (codeSize > bits_per_word)
+        throw std::runtime_error("multi_lane_push_stream::push_n: code size exceeds 64 bits");
+    auto current = codes.begin();
+    auto end = codes.end();
+    while ((nextLane_ != 0) && (current != end))
+        push(*current++, codeSize);
+    size_type codesPerGroup = (bits_per_word / codeSize);
+    auto groupSize = (codesPerGroup * codeSize);
+    auto roundSize = (lane_count * codesPerGroup);
+    while ((end - current) >= roundSize)
+    {
+        std::array<code_type, N> groups;
+        for (auto lane = 0ull; lane < N; ++lane)
+            groups[lane] = current[lane];
+        for (size_type i = 1; i < codesPerGroup; ++i)
+        {
+            for (auto lane = 0ull; lane < N; ++lane)
+            {
+                auto code = current[(i * lane_count) + lane];
+                if constexpr (S == stream_direction::forward)
+                    groups[lane] = ((groups[lane] << codeSize) | code);
+                else
+                    groups[lane] |= (code << (i * codeSize));
+            }
+        }
+        for (auto lane = 0ull; lane < N; ++lane)
+            lanes_[lane].push(groups[lane], groupSize);
+        current += roundSize;
+    }
+    while (current != end)
+        push(*current++, codeSize);
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S, std::size_t N>
+inline auto maniscalco::io::multi_lane_push_stream<S, N>::lane
+(
+    size_type lane
+) -> push_stream<S> &
+{
+    return lanes_[lane];
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S, std::size_t N>
+inline auto maniscalco::io::multi_lane_push_stream<S, N>::size
+(
+    // total bits pushed across all lanes
+) const -> size_type
+{
+    size_type total = 0;
+    for (auto const & lane : lanes_)
+        total += lane.size();
+    return total;
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S, std::size_t N>
+inline void maniscalco::io::multi_lane_push_stream<S, N>::flush
+(
+)
+{
+    for (auto & lane : lanes_)
+        lane.flush();
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S, std::size_t N>
+maniscalco::io::multi_lane_pop_stream<S, N>::multi_lane_pop_stream
+(
+    configuration_type const & configuration
+)
+{
+    auto shared = std::make_shared<demux>();
+    shared->inputHandler_ = configuration.inputHandler_;
+    for (auto lane = 0ull; lane < N; ++lane)
+        lanes_[lane] = pop_stream<S>({[shared, lane](){return shared->next(lane);}});
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S, std::size_t N>
+inline auto maniscalco::io::multi_lane_pop_stream<S, N>::pop
+(
+    size_type codeSize
+) -> code_type
+{
+    auto code = lanes_[nextLane_].pop(codeSize);
+    if (++nextLane_ == lane_count)
+        nextLane_ = 0;
+    return code;
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S, std::size_t N>
+inline void maniscalco::io::multi_lane_pop_stream<S, N>::pop_n
+(
+    // whole rounds pop a group of as many codes as fit in 64 bits from each
+    // lane and split the N groups in an interleaved loop - see push_n
+    std::span<code_type> codes,
+    size_type codeSize
+)
+{
+    static auto constexpr bits_per_word = 64;
+
+    auto current = codes.begin();
+    auto end = codes.end();
+    if (codeSize <= 0)
+    {
+        std::fill(current, end, 0);
+        return;
+    }
+    if (codeSize > bits_per_word)
+        throw std::runtime_error("multi_lane_pop_stream::pop_n: code size exceeds 64 bits");
+    while ((nextLane_ != 0) && (current != end))
+        *current++ = pop(codeSize);
+    size_type codesPerGroup = (bits_per_word / codeSize);
+    auto groupSize = (codesPerGroup * codeSize);
+    auto roundSize = (lane_count * codesPerGroup);
+    auto mask = (codesPerGroup > 1) ? ((1ull << codeSize) - 1) : ~0ull;
+    while ((end - current) >= roundSize)
+    {
+        std::array<code_type, N> groups;
+        for (auto lane = 0ull; lane < N; ++lane)
+            groups[lane] = lanes_[lane].pop(groupSize);
+        for (size_type i = 0; i < codesPerGroup; ++i)
+        {
+            // forward groups hold the first code in the high order bits and
+            // reverse groups in the low order bits
+            auto shift = (S == stream_direction::forward) ? ((codesPerGroup - 1 - i) * codeSize) : (i * codeSize);
+            for (auto lane = 0ull; lane < N; ++lane)
+                current[(i * lane_count) + lane] = ((groups[lane] >> shift) & mask);
+        }
+        current += roundSize;
+    }
+    while (current != end)
+        *current++ = pop(codeSize);
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S, std::size_t N>
+inline auto maniscalco::io::multi_lane_pop_stream<S, N>::lane
+(
+    size_type lane
+) -> pop_stream<S> &
+{
+    return lanes_[lane];
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S, std::size_t N>
+inline auto maniscalco::io::multi_lane_pop_stream<S, N>::size_consumed
+(
+    // total bits consumed across all lanes
+) const -> size_type
+{
+    size_type total = 0;
+    for (auto const & lane : lanes_)
+        total += lane.size_consumed();
+    return total;
+}
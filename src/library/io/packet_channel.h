@@ -0,0 +1,244 @@
+#pragma once
+
+#include "./stream_direction.h"
+#include "./stream_packet.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <bit>
+#include <memory>
+#include <functional>
+#include <algorithm>
+
+
+namespace maniscalco::io
+{
+
+    // bounded single producer/single consumer ring of stream packets.
+    // connects a push_stream on one thread to a pop_stream on another:
+    //   push_stream's bufferOutputHandler_ = channel.output_handler()
+    //   pop_stream's inputHandler_ = channel.input_handler()
+    // both sides spin briefly and then park when the ring is empty/full.
+    // the channel must outlive both handlers.
+    template <stream_direction S>
+    class packet_channel final
+    {
+    public:
+
+        using size_type = std::int64_t;
+        using packet_type = stream_packet<S>;
+
+        static size_type constexpr default_capacity = 64;
+        static size_type constexpr default_spin_count = (1 << 12);
+
+        struct configuration_type 
+        {
+            size_type capacity_{default_capacity};
+            size_type spinCount_{default_spin_count};
+        };
+
+        packet_channel();
+
+        packet_channel(configuration_type const &);
+
+        // non-copyable, non-movable - handlers refer to the channel
+        packet_channel(packet_channel const &) = delete;
+        packet_channel & operator = (packet_channel const &) = delete;
+
+        ~packet_channel() = default;
+
+        void push
+        (
+            packet_type
+        );
+
+        packet_type pop();
+
+        void close();
+
+        std::function<void(packet_type)> output_handler();
+
+        std::function<packet_type()> input_handler();
+
+    private:
+
+        static auto constexpr cache_line_size = 64;
+
+        void pause() const;
+
+        size_type const spinCount_;
+
+        std::size_t const mask_;
+
+        std::unique_ptr<packet_type []> slots_;
+
+        // consumer owned
+        alignas(cache_line_size) std::atomic<std::size_t> head_{0};
+        std::size_t cachedTail_{0};
+
+        // producer owned
+        alignas(cache_line_size) std::atomic<std::size_t> tail_{0};
+        std::size_t cachedHead_{0};
+
+        // shared - rarely written
+        alignas(cache_line_size) std::atomic<bool> consumerParked_{false};
+        std::atomic<std::uint32_t> consumerSignal_{0};
+        std::atomic<bool> producerParked_{false};
+        std::atomic<std::uint32_t> producerSignal_{0};
+        std::atomic<bool> closed_{false};
+
+    }; // class packet_channel
+
+    using forward_packet_channel = packet_channel<stream_direction::forward>;
+    using reverse_packet_channel = packet_channel<stream_direction::reverse>;
+
+} // namespace maniscalco::io
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+maniscalco::io::packet_channel<S>::packet_channel
+(
+):
+    packet_channel(configuration_type{})
+{
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+maniscalco::io::packet_channel<S>::packet_channel
+(
+    configuration_type const & configuration
+):
+    spinCount_(configuration.spinCount_),
+    mask_(std::bit_ceil((std::size_t)std::max<size_type>(configuration.capacity_, 2)) - 1),
+    slots_(new packet_type[mask_ + 1])
+{
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+inline void maniscalco::io::packet_channel<S>::pause
+(
+) const
+{
+    #if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+    #endif
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+inline void maniscalco::io::packet_channel<S>::push
+(
+    // producer side - blocks while the ring is full
+    packet_type packet
+)
+{
+    auto tail = tail_.load(std::memory_order_relaxed);
+    if ((tail - cachedHead_) > mask_)
+    {
+        for (auto i = 0; (((cachedHead_ = head_.load(std::memory_order_acquire)), (tail - cachedHead_) > mask_)); ++i)
+        {
+            if (i < spinCount_)
+            {
+                pause();
+                continue;
+            }
+            // park until consumer frees a slot
+            auto signal = producerSignal_.load(std::memory_order_seq_cst);
+            producerParked_.store(true, std::memory_order_seq_cst);
+            if ((tail - head_.load(std::memory_order_seq_cst)) > mask_)
+                producerSignal_.wait(signal, std::memory_order_seq_cst);
+            producerParked_.store(false, std::memory_order_relaxed);
+        }
+    }
+    slots_[tail & mask_] = std::move(packet);
+    tail_.store(tail + 1, std::memory_order_seq_cst);
+    if (consumerParked_.load(std::memory_order_seq_cst))
+    {
+        consumerSignal_.fetch_add(1, std::memory_order_seq_cst);
+        consumerSignal_.notify_one();
+    }
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+inline auto maniscalco::io::packet_channel<S>::pop
+(
+    // consumer side - blocks while the ring is empty.
+    // returns an empty packet once the channel is closed and drained.
+) -> packet_type
+{
+    auto head = head_.load(std::memory_order_relaxed);
+    if (head == cachedTail_)
+    {
+        for (auto i = 0; ((cachedTail_ = tail_.load(std::memory_order_acquire)) == head); ++i)
+        {
+            if (closed_.load(std::memory_order_acquire))
+            {
+                // recheck to avoid missing packets pushed prior to close
+                if ((cachedTail_ = tail_.load(std::memory_order_acquire)) == head)
+                    return {};
+                break;
+            }
+            if (i < spinCount_)
+            {
+                pause();
+                continue;
+            }
+            // park until producer publishes a packet or closes
+            auto signal = consumerSignal_.load(std::memory_order_seq_cst);
+            consumerParked_.store(true, std::memory_order_seq_cst);
+            if ((tail_.load(std::memory_order_seq_cst) == head) && (!closed_.load(std::memory_order_seq_cst)))
+                consumerSignal_.wait(signal, std::memory_order_seq_cst);
+            consumerParked_.store(false, std::memory_order_relaxed);
+        }
+    }
+    auto packet = std::move(slots_[head & mask_]);
+    head_.store(head + 1, std::memory_order_seq_cst);
+    if (producerParked_.load(std::memory_order_seq_cst))
+    {
+        producerSignal_.fetch_add(1, std::memory_order_seq_cst);
+        producerSignal_.notify_one();
+    }
+    return packet;
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+inline void maniscalco::io::packet_channel<S>::close
+(
+    // producer side - signal end of stream
+)
+{
+    closed_.store(true, std::memory_order_seq_cst);
+    consumerSignal_.fetch_add(1, std::memory_order_seq_cst);
+    consumerSignal_.notify_all();
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+inline auto maniscalco::io::packet_channel<S>::output_handler
+(
+) -> std::function<void(packet_type)>
+{
+    return [this](packet_type packet){push(std::move(packet));};
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+inline auto maniscalco::io::packet_channel<S>::input_handler
+(
+) -> std::function<packet_type()>
+{
+    return [this](){return pop();};
+}
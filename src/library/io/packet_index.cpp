@@ -0,0 +1,268 @@
+#include "./packet_index.h"
+#include "./packet_record.h"
+
+#include <include/endian.h>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
+
+
+namespace
+{
+
+    // index file layout (all fields little endian):
+    //   std::uint64_t  magic
+    //   std::uint64_t  number of packets
+    //   { std::uint64_t bit offset, std::uint64_t record offset } * (number of packets + 1)
+    static std::uint64_t constexpr index_file_magic = 0x7865646e69747370ull; // "pstindex"
+
+    static std::size_t constexpr entry_size = (2 * sizeof(std::uint64_t));
+
+    // entries are read and written this many at a time
+    static std::size_t constexpr entries_per_block = 4096;
+
+
+    //=========================================================================
+    inline void store_little_endian
+    (
+        std::uint8_t * destination,
+        std::uint64_t value
+    )
+    {
+        value = maniscalco::endian_swap<std::endian::native, std::endian::little>(value);
+        std::memcpy(destination, &value, sizeof(value));
+    }
+
+
+    //=========================================================================
+    inline std::uint64_t load_little_endian
+    (
+        std::uint8_t const * source
+    )
+    {
+        std::uint64_t value;
+        std::memcpy(&value, source, sizeof(value));
+        return maniscalco::endian_swap<std::endian::little, std::endian::native>(value);
+    }
+
+} // namespace
+
+
+//=============================================================================
+maniscalco::io::packet_index::packet_index
+(
+):
+    entries_(1, entry{0, 0})
+{
+}
+
+
+//=============================================================================
+void maniscalco::io::packet_index::append
+(
+    // append a packet of 'packetSize' bits
+    size_type packetSize
+)
+{
+    auto const & last = entries_.back();
+    entries_.push_back({last.bitOffset_ + packetSize,
+            last.recordOffset_ + sizeof(packet_record::header_type) + packet_record::byte_count(packetSize)});
+}
+
+
+//=============================================================================
+void maniscalco::io::packet_index::append
+(
+    // append a packet of 'packetSize' bits stored in a record of 'recordSize'
+    // bytes (for containers whose records are not packet_records)
+    size_type packetSize,
+    size_type recordSize
+)
+{
+    auto const & last = entries_.back();
+    entries_.push_back({last.bitOffset_ + packetSize, last.recordOffset_ + recordSize});
+}
+
+
+//=============================================================================
+auto maniscalco::io::packet_index::packet_count
+(
+) const -> size_type
+{
+    return (entries_.size() - 1);
+}
+
+
+//=============================================================================
+auto maniscalco::io::packet_index::bit_offset
+(
+    size_type packetNumber
+) const -> size_type
+{
+    return entries_[packetNumber].bitOffset_;
+}
+
+
+//=============================================================================
+auto maniscalco::io::packet_index::record_offset
+(
+    size_type packetNumber
+) const -> size_type
+{
+    return entries_[packetNumber].recordOffset_;
+}
+
+
+//=============================================================================
+auto maniscalco::io::packet_index::size
+(
+    // returns total number of bits indexed
+) const -> size_type
+{
+    return entries_.back().bitOffset_;
+}
+
+
+//=============================================================================
+auto maniscalco::io::packet_index::find
+(
+    // returns the packet containing the bit at 'bitPosition'.
+    // returns packet_count() if 'bitPosition' is at or beyond the end of the stream.
+    size_type bitPosition
+) const -> size_type
+{
+    if (bitPosition < 0)
+        return 0;
+    auto iter = std::upper_bound(entries_.begin(), entries_.end(), (std::uint64_t)bitPosition,
+            [](auto position, auto const & e){return (position < e.bitOffset_);});
+    return std::min<size_type>(std::distance(entries_.begin(), iter) - 1, packet_count());
+}
+
+
+//=============================================================================
+void maniscalco::io::packet_index::save
+(
+    std::string const & path
+) const
+{
+    std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+    save(stream);
+    if (!stream)
+        throw std::runtime_error("packet_index: failed to write " + path);
+}
+
+
+//=============================================================================
+auto maniscalco::io::packet_index::load
+(
+    std::string const & path
+) -> packet_index
+{
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream)
+        throw std::runtime_error("packet_index: failed to open " + path);
+    return load(stream);
+}
+
+
+//=============================================================================
+void maniscalco::io::packet_index::save
+(
+    std::ostream & stream
+) const
+{
+    std::array<std::uint8_t, 2 * sizeof(std::uint64_t)> header;
+    store_little_endian(header.data(), index_file_magic);
+    store_little_endian(header.data() + sizeof(std::uint64_t), packet_count());
+    stream.write(reinterpret_cast<char const *>(header.data()), header.size());
+
+    std::vector<std::uint8_t> block(entries_per_block * entry_size);
+    for (std::size_t i = 0; i < entries_.size(); )
+    {
+        auto n = std::min(entries_per_block, entries_.size() - i);
+        for (std::size_t j = 0; j < n; ++j, ++i)
+        {
+            auto bytes = (block.data() + (j * entry_size));
+            store_little_endian(bytes, entries_[i].bitOffset_);
+            store_little_endian(bytes + sizeof(std::uint64_t), entries_[i].recordOffset_);
+        }
+        stream.write(reinterpret_cast<char const *>(block.data()), n * entry_size);
+    }
+}
+
+
+//=============================================================================
+auto maniscalco::io::packet_index::load
+(
+    std::istream & stream
+) -> packet_index
+{
+    std::array<std::uint8_t, 2 * sizeof(std::uint64_t)> header;
+    stream.read(reinterpret_cast<char *>(header.data()), header.size());
+    if ((!stream) || (load_little_endian(header.data()) != index_file_magic))
+        throw std::runtime_error("packet_index: invalid index");
+    auto entryCount = (load_little_endian(header.data() + sizeof(std::uint64_t)) + 1);
+    if (entryCount == 0)
+        throw std::runtime_error("packet_index: invalid index");
+
+    // read a block at a time so that a corrupt count fails as truncated 
+    // rather than allocating for entries which are not there
+    packet_index result;
+    result.entries_.clear();
+    std::vector<std::uint8_t> block(entries_per_block * entry_size);
+    while (result.entries_.size() < entryCount)
+    {
+        auto n = (std::size_t)std::min<std::uint64_t>(entries_per_block, entryCount - result.entries_.size());
+        stream.read(reinterpret_cast<char *>(block.data()), n * entry_size);
+        if (!stream)
+            throw std::runtime_error("packet_index: truncated index");
+        for (std::size_t j = 0; j < n; ++j)
+        {
+            auto bytes = (block.data() + (j * entry_size));
+            result.entries_.push_back({load_little_endian(bytes), load_little_endian(bytes + sizeof(std::uint64_t))});
+        }
+    }
+    return result;
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+maniscalco::io::packet_index_output_handler<S>::packet_index_output_handler
+(
+    configuration_type const & configuration
+):
+    bufferOutputHandler_(configuration.bufferOutputHandler_),
+    packetIndex_(configuration.packetIndex_)
+{
+    if (!packetIndex_)
+        throw std::runtime_error("packet_index_output_handler: packet index is required");
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+void maniscalco::io::packet_index_output_handler<S>::operator()
+(
+    packet_type packet
+)
+{
+    packetIndex_->append(packet.size());
+    bufferOutputHandler_(std::move(packet));
+}
+
+
+//=============================================================================
+namespace maniscalco::io
+{
+    template class packet_index_output_handler<stream_direction::forward>;
+    template class packet_index_output_handler<stream_direction::reverse>;
+
+} // maniscalco
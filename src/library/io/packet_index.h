@@ -0,0 +1,137 @@
+#pragma once
+
+#include "./stream_direction.h"
+#include "./stream_packet.h"
+
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+namespace maniscalco::io
+{
+
+    // cumulative bit offset of each packet in a stream along with the byte
+    // offset of each packet's record in a packet_record file (see packet_record.h).
+    // recorded during push by packet_index_output_handler and used by
+    // pop_stream::seek to locate the packet containing a given bit position.
+    class packet_index final
+    {
+    public:
+
+        using size_type = std::int64_t;
+
+        packet_index();
+
+        packet_index(packet_index const &) = default;
+        packet_index & operator = (packet_index const &) = default;
+        packet_index(packet_index &&) = default;
+        packet_index & operator = (packet_index &&) = default;
+
+        ~packet_index() = default;
+
+        void append
+        (
+            size_type
+        );
+
+        void append
+        (
+            size_type,
+            size_type
+        );
+
+        size_type packet_count() const;
+
+        // valid for [0, packet_count()].  the offset of packet_count() is the
+        // total size of the stream
+        size_type bit_offset
+        (
+            size_type
+        ) const;
+
+        size_type record_offset
+        (
+            size_type
+        ) const;
+
+        size_type size() const;
+
+        size_type find
+        (
+            size_type
+        ) const;
+
+        void save
+        (
+            std::string const &
+        ) const;
+
+        static packet_index load
+        (
+            std::string const &
+        );
+
+        void save
+        (
+            std::ostream &
+        ) const;
+
+        static packet_index load
+        (
+            std::istream &
+        );
+
+    private:
+
+        struct entry
+        {
+            std::uint64_t bitOffset_;
+            std::uint64_t recordOffset_;
+        };
+
+        std::vector<entry> entries_;
+
+    }; // class packet_index
+
+
+    // records each packet in a packet_index before forwarding it to the next handler
+    template <stream_direction S>
+    class packet_index_output_handler final
+    {
+    public:
+
+        using packet_type = stream_packet<S>;
+        using buffer_output_handler = std::function<void(packet_type)>;
+
+        struct configuration_type
+        {
+            buffer_output_handler bufferOutputHandler_;
+            std::shared_ptr<packet_index> packetIndex_;
+        };
+
+        packet_index_output_handler(configuration_type const &);
+
+        // copies share the same packet index
+        packet_index_output_handler(packet_index_output_handler const &) = default;
+        packet_index_output_handler & operator = (packet_index_output_handler const &) = default;
+
+        ~packet_index_output_handler() = default;
+
+        void operator()
+        (
+            packet_type
+        );
+
+    private:
+
+        buffer_output_handler bufferOutputHandler_;
+
+        std::shared_ptr<packet_index> packetIndex_;
+
+    }; // class packet_index_output_handler
+
+} // namespace maniscalco::io
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "./buffer.h"
+#include "./stream_direction.h"
+#include "./stream_packet.h"
+
+#include <cstdint>
+#include <utility>
+
+
+namespace maniscalco::io
+{
+
+    // length prefixed packet record used by the file and socket handlers 
+    // (compatible with io_demo's file stream):
+    //   std::uint32_t  number of bits in packet
+    //   std::uint8_t[] ((bits + 7) / 8) bytes of packet data
+    // forward packets occupy the leading bits of the data, reverse packets 
+    // occupy the trailing bits.
+    struct packet_record
+    {
+        using size_type = std::int64_t;
+        using header_type = std::uint32_t;
+
+        static auto constexpr bits_per_byte = 8;
+
+        static size_type byte_count
+        (
+            size_type bitCount
+        )
+        {
+            return ((bitCount + bits_per_byte - 1) / bits_per_byte);
+        }
+
+        template <stream_direction S>
+        static std::pair<std::uint8_t const *, size_type> bytes
+        (
+            // returns the first byte and number of bytes occupied by packet.
+            // assumes that the leading edge of the packet is byte aligned 
+            // (which is always the case for packets produced by push_stream)
+            stream_packet<S> const & packet
+        )
+        {
+            auto numBytes = byte_count(packet.size());
+            if constexpr (S == stream_direction::forward)
+                return {packet.data() + (packet.startOffset_ / bits_per_byte), numBytes};
+            else
+                return {packet.data() + (packet.startOffset_ / bits_per_byte) - numBytes, numBytes};
+        }
+
+        template <stream_direction S>
+        static size_type data_offset
+        (
+            // returns the byte offset within a buffer of 'capacity' bytes at which
+            // the data of a record of 'numBytes' should be placed
+            size_type capacity,
+            size_type numBytes
+        )
+        {
+            if constexpr (S == stream_direction::forward)
+                return 0;
+            else
+                return (capacity - numBytes);
+        }
+
+        template <stream_direction S>
+        static stream_packet<S> make_packet
+        (
+            // returns packet for a record whose data was placed at data_offset()
+            buffer && data,
+            size_type bitCount
+        )
+        {
+            if constexpr (S == stream_direction::forward)
+            {
+                return {std::move(data), 0, bitCount};
+            }
+            else
+            {
+                auto endOfBuffer = (data.capacity() * bits_per_byte);
+                return {std::move(data), endOfBuffer, endOfBuffer - bitCount};
+            }
+        }
+    };
+
+} // namespace maniscalco::io
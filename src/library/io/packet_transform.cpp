@@ -0,0 +1,335 @@
+#include "./packet_transform.h"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <algorithm>
+#include <utility>
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+class maniscalco::io::transform_output_handler<S>::state final
+{
+public:
+
+    state
+    (
+        configuration_type const & configuration
+    ):
+        bufferOutputHandler_(configuration.bufferOutputHandler_),
+        packetTransform_(configuration.packetTransform_),
+        threadPool_(configuration.threadPool_ ? configuration.threadPool_ : std::make_shared<thread_pool>(thread_pool::configuration_type{})),
+        maxInFlight_(std::max<size_type>(configuration.maxInFlight_, 1))
+    {
+        if (!packetTransform_)
+            throw std::runtime_error("transform_output_handler: packet transform is required");
+    }
+
+    ~state()
+    {
+        // tasks refer to this state so wait for them to finish
+        std::unique_lock lock(mutex_);
+        notFull_.wait(lock, [&](){return (inFlight_ == 0);});
+    }
+
+    void push
+    (
+        packet_type packet
+    )
+    {
+        std::unique_lock lock(mutex_);
+        notFull_.wait(lock, [&](){return ((inFlight_ < maxInFlight_) || (error_));});
+        rethrow_error();
+        auto sequence = nextSequence_++;
+        pending_.emplace_back();
+        ++inFlight_;
+        lock.unlock();
+        // thread_pool tasks must be copyable
+        threadPool_->submit([this, sequence, packet = std::make_shared<packet_type>(std::move(packet))]()
+                {
+                    try
+                    {
+                        complete(sequence, packetTransform_(std::move(*packet)));
+                    }
+                    catch (...)
+                    {
+                        {
+                            std::lock_guard lock(mutex_);
+                            if (!error_)
+                                error_ = std::current_exception();
+                        }
+                        complete(sequence, {});
+                    }
+                });
+    }
+
+    void flush()
+    {
+        std::unique_lock lock(mutex_);
+        notFull_.wait(lock, [&](){return (inFlight_ == 0);});
+        rethrow_error();
+    }
+
+private:
+
+    void rethrow_error()
+    {
+        if (error_)
+            std::rethrow_exception(std::exchange(error_, nullptr));
+    }
+
+    void complete
+    (
+        // store the transformed packet and, unless another thread is already
+        // doing so, write every packet which is now in sequence
+        std::uint64_t sequence,
+        packet_type packet
+    )
+    {
+        std::unique_lock lock(mutex_);
+        pending_[sequence - nextWrite_].emplace(std::move(packet));
+        if (writing_)
+            return;
+        writing_ = true;
+        while ((!pending_.empty()) && (pending_.front()))
+        {
+            auto next = std::move(*pending_.front());
+            pending_.pop_front();
+            ++nextWrite_;
+            lock.unlock();
+            try
+            {
+                if (next.size() > 0)
+                    bufferOutputHandler_(std::move(next));
+            }
+            catch (...)
+            {
+                lock.lock();
+                if (!error_)
+                    error_ = std::current_exception();
+                lock.unlock();
+            }
+            lock.lock();
+            --inFlight_;
+            notFull_.notify_all();
+        }
+        writing_ = false;
+    }
+
+    buffer_output_handler bufferOutputHandler_;
+
+    packet_transform packetTransform_;
+
+    std::shared_ptr<thread_pool> threadPool_;
+
+    size_type const maxInFlight_;
+
+    std::mutex mutex_;
+
+    std::condition_variable notFull_;
+
+    // transformed packets awaiting their turn, indexed by sequence - nextWrite_
+    std::deque<std::optional<packet_type>> pending_;
+
+    std::uint64_t nextSequence_{0};
+
+    std::uint64_t nextWrite_{0};
+
+    size_type inFlight_{0};
+
+    bool writing_{false};
+
+    std::exception_ptr error_;
+
+}; // class transform_output_handler<S>::state
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+class maniscalco::io::transform_input_handler<S>::state final
+{
+public:
+
+    state
+    (
+        configuration_type const & configuration
+    ):
+        inputHandler_(configuration.inputHandler_),
+        packetTransform_(configuration.packetTransform_),
+        threadPool_(configuration.threadPool_ ? configuration.threadPool_ : std::make_shared<thread_pool>(thread_pool::configuration_type{})),
+        readAhead_(std::max<size_type>(configuration.readAhead_, 1))
+    {
+        if (!packetTransform_)
+            throw std::runtime_error("transform_input_handler: packet transform is required");
+    }
+
+    ~state()
+    {
+        // tasks refer to this state so wait for them to finish
+        std::unique_lock lock(mutex_);
+        ready_.wait(lock, [&](){return (inFlight_ == 0);});
+    }
+
+    packet_type pop()
+    {
+        read_ahead();
+        std::unique_lock lock(mutex_);
+        if (pending_.empty())
+            return {};
+        ready_.wait(lock, [&](){return (pending_.front().has_value());});
+        auto packet = std::move(*pending_.front());
+        pending_.pop_front();
+        ++nextRead_;
+        // a packet whose transform failed is left empty
+        if ((packet.size() == 0) && (error_))
+            std::rethrow_exception(std::exchange(error_, nullptr));
+        return packet;
+    }
+
+private:
+
+    void read_ahead()
+    {
+        // input is read on the consumer's thread (input handlers need not be
+        // thread safe).  only the transforms run on the pool.
+        while (!endOfInput_)
+        {
+            std::unique_lock lock(mutex_);
+            if ((size_type)pending_.size() >= readAhead_)
+                return;
+            lock.unlock();
+            auto packet = inputHandler_();
+            if (packet.size() == 0)
+            {
+                endOfInput_ = true;
+                return;
+            }
+            lock.lock();
+            auto sequence = nextSequence_++;
+            pending_.emplace_back();
+            ++inFlight_;
+            lock.unlock();
+            threadPool_->submit([this, sequence, packet = std::make_shared<packet_type>(std::move(packet))]()
+                    {
+                        std::optional<packet_type> result;
+                        std::exception_ptr error;
+                        try
+                        {
+                            result.emplace(packetTransform_(std::move(*packet)));
+                        }
+                        catch (...)
+                        {
+                            error = std::current_exception();
+                            result.emplace();
+                        }
+                        std::lock_guard lock(mutex_);
+                        if ((error) && (!error_))
+                            error_ = error;
+                        pending_[sequence - nextRead_] = std::move(result);
+                        --inFlight_;
+                        ready_.notify_all();
+                    });
+        }
+    }
+
+    input_handler inputHandler_;
+
+    packet_transform packetTransform_;
+
+    std::shared_ptr<thread_pool> threadPool_;
+
+    size_type const readAhead_;
+
+    std::mutex mutex_;
+
+    std::condition_variable ready_;
+
+    // packets being transformed, indexed by sequence - nextRead_
+    std::deque<std::optional<packet_type>> pending_;
+
+    std::uint64_t nextSequence_{0};
+
+    std::uint64_t nextRead_{0};
+
+    size_type inFlight_{0};
+
+    bool endOfInput_{false};
+
+    std::exception_ptr error_;
+
+}; // class transform_input_handler<S>::state
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+maniscalco::io::transform_output_handler<S>::transform_output_handler
+(
+    configuration_type const & configuration
+):
+    state_(std::make_shared<state>(configuration))
+{
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+void maniscalco::io::transform_output_handler<S>::operator()
+(
+    // submit packet for transformation.  blocks if 'maxInFlight_' packets
+    // are already pending.  rethrows any exception raised by the transform
+    // or the next handler since the previous call.
+    packet_type packet
+)
+{
+    state_->push(std::move(packet));
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+void maniscalco::io::transform_output_handler<S>::flush
+(
+    // blocks until every packet submitted has been transformed and written.
+    // rethrows any exception raised by the transform or the next handler.
+)
+{
+    state_->flush();
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+maniscalco::io::transform_input_handler<S>::transform_input_handler
+(
+    configuration_type const & configuration
+):
+    state_(std::make_shared<state>(configuration))
+{
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+auto maniscalco::io::transform_input_handler<S>::operator()
+(
+    // returns the next transformed packet or an empty packet at the end of
+    // input.  rethrows any exception raised by the transform.
+) -> packet_type
+{
+    return state_->pop();
+}
+
+
+//=============================================================================
+namespace maniscalco::io
+{
+    template class transform_output_handler<stream_direction::forward>;
+    template class transform_output_handler<stream_direction::reverse>;
+    template class transform_input_handler<stream_direction::forward>;
+    template class transform_input_handler<stream_direction::reverse>;
+
+} // maniscalco
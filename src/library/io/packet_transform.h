@@ -0,0 +1,112 @@
+#pragma once
+
+#include "./stream_direction.h"
+#include "./stream_packet.h"
+#include "./thread_pool.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+
+namespace maniscalco::io
+{
+
+    // pipeline stage which applies a transform (ex: compression, encryption)
+    // to each packet on a thread pool rather than on the encoder's thread.
+    // packets are transformed concurrently and delivered to the next handler
+    // in their original order.  the next handler is never invoked
+    // concurrently.  a transform which returns an empty packet drops it.
+    // at most 'maxInFlight_' packets are pending before the producer blocks.
+    template <stream_direction S>
+    class transform_output_handler final
+    {
+    public:
+
+        using size_type = std::int64_t;
+        using packet_type = stream_packet<S>;
+        using buffer_output_handler = std::function<void(packet_type)>;
+        using packet_transform = std::function<packet_type(packet_type)>;
+
+        static size_type constexpr default_max_in_flight = 16;
+
+        struct configuration_type
+        {
+            buffer_output_handler bufferOutputHandler_;
+            // must be safe to invoke concurrently
+            packet_transform packetTransform_;
+            // defaults to a pool with one thread per core
+            std::shared_ptr<thread_pool> threadPool_;
+            size_type maxInFlight_{default_max_in_flight};
+        };
+
+        transform_output_handler(configuration_type const &);
+
+        // copies share the same pipeline
+        transform_output_handler(transform_output_handler const &) = default;
+        transform_output_handler & operator = (transform_output_handler const &) = default;
+
+        ~transform_output_handler() = default;
+
+        void operator()
+        (
+            packet_type
+        );
+
+        void flush();
+
+    private:
+
+        class state;
+
+        std::shared_ptr<state> state_;
+
+    }; // class transform_output_handler
+
+
+    // the inverse stage for pop_stream.  packets are read from the input
+    // handler up to 'readAhead_' packets ahead of the consumer and the inverse
+    // transform is applied to them concurrently.  packets are returned in
+    // their original order.  the transform must not return an empty packet
+    // (pop_stream treats an empty packet as the end of the stream).
+    template <stream_direction S>
+    class transform_input_handler final
+    {
+    public:
+
+        using size_type = std::int64_t;
+        using packet_type = stream_packet<S>;
+        using input_handler = std::function<packet_type()>;
+        using packet_transform = std::function<packet_type(packet_type)>;
+
+        static size_type constexpr default_read_ahead = 16;
+
+        struct configuration_type
+        {
+            input_handler inputHandler_;
+            // must be safe to invoke concurrently
+            packet_transform packetTransform_;
+            // defaults to a pool with one thread per core
+            std::shared_ptr<thread_pool> threadPool_;
+            size_type readAhead_{default_read_ahead};
+        };
+
+        transform_input_handler(configuration_type const &);
+
+        // copies share the same pipeline
+        transform_input_handler(transform_input_handler const &) = default;
+        transform_input_handler & operator = (transform_input_handler const &) = default;
+
+        ~transform_input_handler() = default;
+
+        packet_type operator()();
+
+    private:
+
+        class state;
+
+        std::shared_ptr<state> state_;
+
+    }; // class transform_input_handler
+
+} // namespace maniscalco::io
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "./stream_direction.h"
+#include "./stream_packet.h"
+#include "./pop_stream.h"
+#include "./thread_pool.h"
+
+#include <cstdint>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+namespace maniscalco::io
+{
+
+    // decodes the packets of a packet aligned stream (see push_stream::begin_record)
+    // across a thread pool.  each packet is decoded by its own pop_stream via
+    // decoder(pop_stream<S> &, size_type packetSize) and the results are
+    // returned in packet order.  when the stream was written with a record
+    // count header the decoder pops it first:
+    //   auto recordCount = stream.pop(push_stream<S>::record_count_header_size);
+    template <stream_direction S, typename F>
+    auto parallel_decode
+    (
+        thread_pool & threadPool,
+        std::vector<stream_packet<S>> packets,
+        F const & decoder
+    ) -> std::vector<std::invoke_result_t<F const &, pop_stream<S> &, std::int64_t>>
+    {
+        using result_type = std::invoke_result_t<F const &, pop_stream<S> &, std::int64_t>;
+        using packet_type = stream_packet<S>;
+
+        std::vector<std::optional<result_type>> results(packets.size());
+        threadPool.parallel_for(packets.size(), [&](auto packetNumber)
+                {
+                    auto & packet = packets[packetNumber];
+                    auto packetSize = packet.size();
+                    pop_stream<S> stream({[packet = &packet, loaded = false]() mutable
+                            {
+                                // the packet followed by empty packets
+                                if (std::exchange(loaded, true))
+                                    return packet_type{};
+                                return std::move(*packet);
+                            }});
+                    results[packetNumber].emplace(decoder(stream, packetSize));
+                });
+
+        std::vector<result_type> decoded;
+        decoded.reserve(results.size());
+        for (auto & result : results)
+            decoded.emplace_back(std::move(*result));
+        return decoded;
+    }
+
+} // namespace maniscalco::io
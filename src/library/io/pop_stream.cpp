@@ -1,22 +1,158 @@
 #include "./pop_stream.h"
 
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+
+namespace
+{
+
+    using size_type = std::int64_t;
+    using code_type = std::uint64_t;
+    using word_type = std::uint64_t;
+
+    // pop_n unpacks codes in blocks of 64.  a block of 64 codes of width W
+    // always occupies exactly W 64 bit words.  the block is first realigned 
+    // to a word boundary so that every shift and mask used to extract the 
+    // codes is a compile time constant.
+    static auto constexpr codes_per_block = 64;
+    static auto constexpr bits_per_word = 64;
+    static auto constexpr bits_per_byte = 8;
+
+
+    //=========================================================================
+    template <std::size_t W>
+    inline void load_block
+    (
+        // load the W words beginning at bit 'position' as native words
+        std::uint8_t const * data,
+        size_type position,
+        word_type * words
+    )
+    {
+        auto source = data + (position / bits_per_byte);
+        auto offset = (position % bits_per_byte);
+        word_type next;
+        std::memcpy(&next, source, sizeof(next));
+        next = maniscalco::endian_swap<std::endian::big, std::endian::native>(next);
+        for (auto i = 0ull; i < W; ++i)
+        {
+            auto word = next;
+            if ((i + 1 < W) || (offset != 0))
+            {
+                std::memcpy(&next, source + ((i + 1) * sizeof(word_type)), sizeof(next));
+                next = maniscalco::endian_swap<std::endian::big, std::endian::native>(next);
+            }
+            words[i] = (offset != 0) ? ((word << offset) | (next >> (bits_per_word - offset))) : word;
+        }
+    }
+
+
+    //=========================================================================
+    template <std::size_t W, std::size_t I, typename T>
+    inline void unpack_code_forward
+    (
+        // extract code I of the block msb first (forward stream order)
+        word_type const * words,
+        T * codes
+    )
+    {
+        static auto constexpr mask = (W == bits_per_word) ? ~0ull : ((1ull << W) - 1);
+        static auto constexpr position = (I * W);
+        static auto constexpr index = (position / bits_per_word);
+        static auto constexpr offset = (position % bits_per_word);
+        if constexpr ((offset + W) <= bits_per_word)
+            codes[I] = (T)((words[index] >> (bits_per_word - offset - W)) & mask);
+        else
+            codes[I] = (T)(((words[index] << (offset + W - bits_per_word)) | 
+                    (words[index + 1] >> ((2 * bits_per_word) - offset - W))) & mask);
+    }
+
+
+    //=========================================================================
+    template <std::size_t W, std::size_t I, typename T>
+    inline void unpack_code_reverse
+    (
+        // extract code I of the block lsb first (reverse stream order).
+        // the last word of the block is the first to be consumed.
+        word_type const * words,
+        T * codes
+    )
+    {
+        static auto constexpr mask = (W == bits_per_word) ? ~0ull : ((1ull << W) - 1);
+        static auto constexpr position = (I * W);
+        static auto constexpr index = (W - 1 - (position / bits_per_word));
+        static auto constexpr offset = (position % bits_per_word);
+        if constexpr ((offset + W) <= bits_per_word)
+            codes[I] = (T)((words[index] >> offset) & mask);
+        else
+            codes[I] = (T)(((words[index] >> offset) | (words[index - 1] << (bits_per_word - offset))) & mask);
+    }
+
+
+    //=========================================================================
+    template <maniscalco::io::stream_direction S, typename T, std::size_t W>
+    void unpack_block
+    (
+        // unpack the 64 codes occupying the W words beginning at bit 'position'
+        std::uint8_t const * data,
+        size_type position,
+        T * codes
+    )
+    {
+        word_type words[W];
+        load_block<W>(data, position, words);
+        [&]<std::size_t ... I>(std::index_sequence<I ...>)
+        {
+            if constexpr (S == maniscalco::io::stream_direction::forward)
+                (unpack_code_forward<W, I>(words, codes), ...);
+            else
+                (unpack_code_reverse<W, I>(words, codes), ...);
+        }(std::make_index_sequence<codes_per_block>());
+    }
+
+
+    //=========================================================================
+    template <maniscalco::io::stream_direction S, typename T>
+    auto constexpr unpack_block_table = []<std::size_t ... W>(std::index_sequence<W ...>)
+            {
+                // index by code width.  width 0 is never dispatched
+                using unpack_block_function = void(*)(std::uint8_t const *, size_type, T *);
+                return std::array<unpack_block_function, sizeof ... (W) + 1>{nullptr, &unpack_block<S, T, W + 1> ...};
+            }(std::make_index_sequence<sizeof(T) * bits_per_byte>());
+
+} // namespace
+
+
 
 //=============================================================================
-template <maniscalco::io::stream_direction S>
-maniscalco::io::pop_stream<S>::pop_stream
+template <maniscalco::io::stream_direction S, typename T>
+auto maniscalco::io::select_unpack_block
 (
-    configuration_type const & configuration
-): 
-    inputHandler_(configuration.inputHandler_)
+    // 0 < codeSize <= bits in T
+    std::int64_t codeSize
+) -> unpack_block_function<T>
 {
+    return unpack_block_table<S, T>[codeSize];
 }
 
 
-
 //=============================================================================
 namespace maniscalco::io
 {
-    template class pop_stream<stream_direction::forward>;
-    template class pop_stream<stream_direction::reverse>;
+    template unpack_block_function<std::uint8_t> select_unpack_block<stream_direction::forward, std::uint8_t>(std::int64_t);
+    template unpack_block_function<std::uint16_t> select_unpack_block<stream_direction::forward, std::uint16_t>(std::int64_t);
+    template unpack_block_function<std::uint32_t> select_unpack_block<stream_direction::forward, std::uint32_t>(std::int64_t);
+    template unpack_block_function<std::uint64_t> select_unpack_block<stream_direction::forward, std::uint64_t>(std::int64_t);
+    template unpack_block_function<std::uint8_t> select_unpack_block<stream_direction::reverse, std::uint8_t>(std::int64_t);
+    template unpack_block_function<std::uint16_t> select_unpack_block<stream_direction::reverse, std::uint16_t>(std::int64_t);
+    template unpack_block_function<std::uint32_t> select_unpack_block<stream_direction::reverse, std::uint32_t>(std::int64_t);
+    template unpack_block_function<std::uint64_t> select_unpack_block<stream_direction::reverse, std::uint64_t>(std::int64_t);
+
+    template class basic_pop_stream<stream_direction::forward, std::function<stream_packet<stream_direction::forward>()>>;
+    template class basic_pop_stream<stream_direction::reverse, std::function<stream_packet<stream_direction::reverse>()>>;
 
 } // maniscalco
\ No newline at end of file
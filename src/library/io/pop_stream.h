@@ -3,18 +3,43 @@
 #include "./buffer.h"
 #include "./stream_direction.h"
 #include "./stream_packet.h"
+#include "./packet_index.h"
+#include "./stream_statistics.h"
 
 #include <cstdint>
+#include <deque>
 #include <functional>
+#include <memory>
 #include <optional>
 #include <tuple>
+#include <span>
+#include <cstring>
+#include <utility>
+#include <stdexcept>
+#include <algorithm>
 
 
 namespace maniscalco::io
 {
 
-    template <stream_direction S>
-    class pop_stream final 
+    // unpacks a block of 64 codes (see pop_n).  defined in pop_stream.cpp 
+    // so that the table of all widths is only compiled once.
+    template <typename T>
+    using unpack_block_function = void(*)(std::uint8_t const *, std::int64_t, T *);
+
+    template <stream_direction S, typename T>
+    unpack_block_function<T> select_unpack_block
+    (
+        std::int64_t
+    );
+
+
+    // the input handler (Source) is a policy type which is called directly
+    // and can be inlined.  Source is any type callable as stream_packet<S>().
+    // an empty policy occupies no storage.  pop_stream<S> is the 
+    // instantiation using a std::function input handler.
+    template <stream_direction S, typename Source>
+    class basic_pop_stream final 
     {
     public:
 
@@ -23,34 +48,73 @@ namespace maniscalco::io
         using code_type = std::uint64_t;
         using size_type = std::int64_t;
         using packet_type = stream_packet<S>;
-        using input_handler = std::function<packet_type()>;
+        using input_handler = Source;
+        // returns the packet with the given packet number
+        using random_access_input_handler = std::function<packet_type(size_type)>;
+
+        // peek of up to this many bits always succeeds within a packet whose
+        // buffer has slack (see buffer::slack_size) and, with carryOver_, 
+        // anywhere in the stream
+        static size_type constexpr max_guaranteed_peek_size = 57;
 
         struct configuration_type 
         {
             input_handler inputHandler_;
+            // when set all packets are requested by number and seek is enabled
+            random_access_input_handler randomAccessInputHandler_;
+            std::shared_ptr<packet_index const> packetIndex_;
+            // when set the stream reads ahead and copies the next 64 bits of 
+            // the stream (zeros beyond its end) to follow the bits of the 
+            // current packet so that peek is valid across packet boundaries.
+            // as many packets are read ahead as needed to supply those bits
+            // and the first packet is read on construction.  packets whose
+            // buffers have no slack are copied.
+            bool carryOver_{false};
         };
 
-        pop_stream() = default;
+        basic_pop_stream() = default;
 
-        pop_stream(configuration_type const &);
+        basic_pop_stream(configuration_type const &);
 
-        pop_stream(pop_stream &&) = default;
+        basic_pop_stream(basic_pop_stream &&) = default;
 
-        pop_stream& operator = (pop_stream &&) = default;
+        basic_pop_stream & operator = (basic_pop_stream &&) = default;
 
-        // pop_stream is non copyable - move only
-        pop_stream(pop_stream const &) = delete;
-        pop_stream & operator = (pop_stream const &) = delete;
+        // basic_pop_stream is non copyable - move only
+        basic_pop_stream(basic_pop_stream const &) = delete;
+        basic_pop_stream & operator = (basic_pop_stream const &) = delete;
 
-        ~pop_stream() = default;
+        ~basic_pop_stream() = default;
 
         code_type pop
         (
             size_type
         );
 
+        // code size known at compile time
+        template <size_type N>
+        code_type pop();
+
         code_type pop_bit();
 
+        // T may be std::uint8_t, std::uint16_t, std::uint32_t or std::uint64_t.
+        // the code size must not exceed the bits in T (throws otherwise).
+        template <typename T>
+        void pop_n
+        (
+            std::span<T>, 
+            size_type
+        );
+
+        // copy the next 'count' bits into the destination (msb first within
+        // each byte) in the layout used by push_stream::push_bits.  bits of 
+        // the first and last bytes which lie outside of the range are kept.
+        void pop_bits
+        (
+            std::uint8_t *, 
+            size_type
+        );
+
         void discard
         (
             size_type
@@ -61,10 +125,22 @@ namespace maniscalco::io
             size_type
         ) const;
 
+        template <size_type N>
+        std::optional<code_type> peek() const;
+
         size_type size_consumed() const;
 
         void align();
 
+        // requires a random access input handler and packet index
+        void seek
+        (
+            size_type
+        );
+
+        // requires IO_ENABLE_STATISTICS
+        stream_statistics statistics() const requires (statistics_enabled);
+
     private:
 
         code_type pop
@@ -73,9 +149,61 @@ namespace maniscalco::io
             size_type
         ) const;
 
+        template <size_type N>
+        code_type pop
+        (
+            size_type
+        ) const;
+
+        // as pop(where, size) but never reads outside of the buffer.  bytes
+        // outside of the buffer read as zero.
+        code_type pop_safe
+        (
+            size_type, 
+            size_type
+        ) const;
+
+        code_type read
+        (
+            size_type, 
+            size_type
+        ) const;
+
+        code_type pop_straddle
+        (
+            size_type
+        );
+
+        // write the right aligned 'count' bit code to bits 
+        // [position, position + count) of destination
+        static void store_bits
+        (
+            std::uint8_t *, 
+            size_type, 
+            code_type,
+            size_type
+        );
+
         void load_input_buffer();
 
-        input_handler inputHandler_;
+        packet_type next_packet();
+
+        void set_packet
+        (
+            packet_type
+        );
+
+        void carry_over();
+
+        void update_read_limits();
+
+        [[no_unique_address]] input_handler inputHandler_;
+
+        random_access_input_handler randomAccessInputHandler_;
+
+        std::shared_ptr<packet_index const> packetIndex_;
+
+        size_type nextPacketNumber_{0};
 
         buffer buffer_;
 
@@ -85,11 +213,34 @@ namespace maniscalco::io
 
         size_type readPosition_{0};
 
-        size_type maxSafePeekPosition_{0};
+        // the greatest position from which pop(where, size) can load a word 
+        // and one more byte without reading outside of the buffer and its slack
+        size_type maxSafeReadPosition_{0};
+
+        // forward: min(endCurrentBuffer_, maxSafeReadPosition_) so that the 
+        // fast path of pop is a single comparison
+        size_type popEnd_{0};
+
+        // the end of the bits which may be peeked.  endCurrentBuffer_ plus
+        // (forward) or minus (reverse) any bits carried over from the next packet
+        size_type peekEnd_{0};
 
         size_type sizeConsumed_{0};
 
-    }; // class pop_stream
+        bool carryOver_{false};
+
+        // packets read ahead by carry_over (ending with the empty packet once
+        // the end of the stream has been read)
+        std::deque<packet_type> lookAhead_;
+
+        // mutable so that peek can count misses
+        [[no_unique_address]] mutable stream_statistics_recorder<> statistics_;
+
+    }; // class basic_pop_stream
+
+
+    template <stream_direction S>
+    using pop_stream = basic_pop_stream<S, std::function<stream_packet<S>()>>;
 
     using forward_pop_stream = pop_stream<stream_direction::forward>;
     using reverse_pop_stream = pop_stream<stream_direction::reverse>;
@@ -98,45 +249,69 @@ namespace maniscalco::io
 
 
 //=============================================================================
-template <maniscalco::io::stream_direction S>
-auto maniscalco::io::pop_stream<S>::size_consumed
+template <maniscalco::io::stream_direction S, typename Source>
+auto maniscalco::io::basic_pop_stream<S, Source>::size_consumed
 (
     // returns the number of bits consumed by this stream thus far
 ) const -> size_type
 {
-    return (sizeConsumed_ + (readPosition_ - beginCurrentBuffer_));
+    if constexpr (S == stream_direction::forward)
+        return (sizeConsumed_ + (readPosition_ - beginCurrentBuffer_));
+    else
+        return (sizeConsumed_ + (beginCurrentBuffer_ - readPosition_));
 }
 
 
 //=============================================================================
-template <maniscalco::io::stream_direction S>
-inline void maniscalco::io::pop_stream<S>::load_input_buffer
+template <maniscalco::io::stream_direction S, typename Source>
+inline void maniscalco::io::basic_pop_stream<S, Source>::load_input_buffer
 (
 )
 {
-    sizeConsumed_ += (readPosition_ - beginCurrentBuffer_);
-    stream_packet<S> packet = inputHandler_();
-    buffer_ = std::move(packet.buffer_);
-    endCurrentBuffer_ = packet.endOffset_;
-    readPosition_ = beginCurrentBuffer_ = packet.startOffset_;
-    maxSafePeekPosition_ = ((buffer_.capacity() * bits_per_byte) - 32);
+    sizeConsumed_ = size_consumed();
+    if (!lookAhead_.empty())
+    {
+        auto packet = std::move(lookAhead_.front());
+        lookAhead_.pop_front();
+        set_packet(std::move(packet));
+    }
+    else
+    {
+        set_packet(next_packet());
+    }
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S, typename Source>
+inline auto maniscalco::io::basic_pop_stream<S, Source>::read
+(
+    // pop(where, size) where that is safe and pop_safe(where, size) otherwise
+    size_type where, 
+    size_type codeSize
+) const -> code_type
+{
+    return (where <= maxSafeReadPosition_) ? pop(where, codeSize) : pop_safe(where, codeSize);
 }
 
 
 
 //=============================================================================
-template <>
-inline void maniscalco::io::forward_pop_stream::discard
+template <maniscalco::io::stream_direction S, typename Source>
+inline void maniscalco::io::basic_pop_stream<S, Source>::discard
 (
     size_type count
 )
 {
     while (count > 0) 
     {
-        auto available = (size_type)(endCurrentBuffer_ - readPosition_);
+        auto available = (S == stream_direction::forward) ? (endCurrentBuffer_ - readPosition_) : (readPosition_ - endCurrentBuffer_);
         if (available > count)
             available = count;
-        readPosition_ += available;
+        if constexpr (S == stream_direction::forward)
+            readPosition_ += available;
+        else
+            readPosition_ -= available;
         count -= available;
         if (readPosition_ == endCurrentBuffer_)
             load_input_buffer();
@@ -145,159 +320,684 @@ inline void maniscalco::io::forward_pop_stream::discard
 
 
 //=============================================================================
-template <>
-inline void maniscalco::io::forward_pop_stream::align
+template <maniscalco::io::stream_direction S, typename Source>
+inline void maniscalco::io::basic_pop_stream<S, Source>::align
 (
     // discard bits until at next byte bounardy
 )
 {
     if (readPosition_ & 0x07)
     {
-        auto n = (8 - (readPosition_ & 0x07));
+        auto n = (S == stream_direction::forward) ? (8 - (readPosition_ & 0x07)) : (readPosition_ & 0x07);
+        statistics_.count_align_padding(n);
         discard(n);
     }
 }
 
 
 //=============================================================================
-template <>
-inline void maniscalco::io::reverse_pop_stream::discard
+template <maniscalco::io::stream_direction S, typename Source>
+inline auto maniscalco::io::basic_pop_stream<S, Source>::pop_bit
 (
-    size_type count
-)
+) -> code_type
 {
-    // TODO:
-    while (count > 0) 
+    if constexpr (S == stream_direction::forward)
     {
-        auto available = (size_type)(readPosition_ - endCurrentBuffer_);
-        if (available > count)
-            available = count;
-        readPosition_ -= available;
-        count -= available;
-        if (readPosition_ == endCurrentBuffer_)
+        if (readPosition_ >= endCurrentBuffer_)
             load_input_buffer();
+        code_type result = ((buffer_.data()[readPosition_ >> 0x03] & (0x80 >> (readPosition_ & 0x07))) != 0);
+        ++readPosition_;
+        return result;
+    }
+    else
+    {
+        // the next bit is the one immediately before the read position
+        if (readPosition_ <= endCurrentBuffer_)
+            load_input_buffer();
+        --readPosition_;
+        code_type result = ((buffer_.data()[readPosition_ >> 0x03] & (0x80 >> (readPosition_ & 0x07))) != 0);
+        return result;
     }
 }
 
 
 //=============================================================================
-template <>
-inline auto maniscalco::io::forward_pop_stream::pop_bit
+template <maniscalco::io::stream_direction S, typename Source>
+inline auto maniscalco::io::basic_pop_stream<S, Source>::pop
 (
+    // 0 < codeSize <= 64
+    size_type where, 
+    size_type codeSize
+) const -> code_type
+{
+    auto source = (buffer_.data() + (where >> 0x03));
+    auto offset = (where & 0x07);
+    std::uint64_t code;
+    std::memcpy(&code, source, sizeof(code));
+    code = (endian_swap<std::endian::big, std::endian::native>(code) << offset);
+    if ((offset + codeSize) > 64)
+        code |= (source[sizeof(code)] >> (bits_per_byte - offset)); // codes wider than 57 bits
+    return (code >> (64 - codeSize));
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S, typename Source>
+inline auto maniscalco::io::basic_pop_stream<S, Source>::pop
+(
+    size_type codeLength
 ) -> code_type
 {
-    if (readPosition_ >= endCurrentBuffer_)
-        load_input_buffer();
-    code_type result = ((buffer_.data()[readPosition_ >> 0x03] & (0x80 >> (readPosition_ & 0x07))) != 0);
-    ++readPosition_;
-    return result;
+    if constexpr (S == stream_direction::forward)
+    {
+        auto nextReadPosition = (readPosition_ + codeLength);
+        if (nextReadPosition <= popEnd_) 
+        {
+            auto code = pop(readPosition_, codeLength);
+            readPosition_ = nextReadPosition;
+            return code;
+        }
+        else if (nextReadPosition <= endCurrentBuffer_)
+        {
+            // near the end of a buffer without slack
+            auto code = pop_safe(readPosition_, codeLength);
+            readPosition_ = nextReadPosition;
+            return code;
+        }
+        else 
+        {
+            return pop_straddle(codeLength);
+        }
+    }
+    else
+    {
+        auto nextReadPosition = (readPosition_ - codeLength);
+        if ((nextReadPosition >= endCurrentBuffer_) && (nextReadPosition <= maxSafeReadPosition_))
+        {
+            auto code = pop(readPosition_ = nextReadPosition, codeLength);
+            return code;
+        }
+        else if (nextReadPosition >= endCurrentBuffer_)
+        {
+            // near the end of a buffer without slack
+            return pop_safe(readPosition_ = nextReadPosition, codeLength);
+        }
+        else 
+        {
+            return pop_straddle(codeLength);
+        }
+    }
 }
 
 
 //=============================================================================
-template <>
-inline auto maniscalco::io::reverse_pop_stream::pop_bit
+template <maniscalco::io::stream_direction S, typename Source>
+auto maniscalco::io::basic_pop_stream<S, Source>::pop_straddle
 (
+    // the code straddles packets (more than two if packets are shorter than
+    // the code).  forward: the high order bits of the code are at the end of
+    // the current packet.  reverse: the low order bits are.  kept out of line
+    // so that the fast path of pop is small enough to inline.
+    size_type codeLength
 ) -> code_type
 {
-    // TODO:
-    if (--readPosition_ < endCurrentBuffer_)
-        load_input_buffer();
-    code_type result = ((buffer_.data()[readPosition_ >> 0x03] & (0x80 >> (readPosition_ & 0x07))) != 0);
-    return result;
+    if constexpr (S == stream_direction::forward)
+    {
+        code_type code = 0;
+        auto bitsRemaining = codeLength;
+        while (true)
+        {
+            auto n = std::min(endCurrentBuffer_ - readPosition_, bitsRemaining);
+            if (n > 0)
+            {
+                code = (((n < 64) ? (code << n) : 0) | read(readPosition_, n));
+                readPosition_ += n;
+                bitsRemaining -= n;
+            }
+            if (bitsRemaining == 0)
+                break;
+            if (bitsRemaining < codeLength)
+                statistics_.count_straddle();
+            load_input_buffer();
+            if (endCurrentBuffer_ == beginCurrentBuffer_)
+                break; // end of the stream
+        }
+        return (bitsRemaining < 64) ? (code << bitsRemaining) : 0;
+    }
+    else
+    {
+        code_type code = 0;
+        size_type shift = 0;
+        while (true)
+        {
+            auto n = std::min(readPosition_ - endCurrentBuffer_, codeLength - shift);
+            if (n > 0)
+            {
+                readPosition_ -= n;
+                code |= (read(readPosition_, n) << shift);
+                shift += n;
+            }
+            if (shift == codeLength)
+                break;
+            if (shift > 0)
+                statistics_.count_straddle();
+            load_input_buffer();
+            if (endCurrentBuffer_ == beginCurrentBuffer_)
+                break; // end of the stream
+        }
+        return code;
+    }
 }
 
 
 //=============================================================================
-template <maniscalco::io::stream_direction S>
-inline auto maniscalco::io::pop_stream<S>::pop
+template <maniscalco::io::stream_direction S, typename Source>
+inline auto maniscalco::io::basic_pop_stream<S, Source>::peek
 (
-    size_type where, 
     size_type codeSize
+) const -> std::optional<code_type>
+{
+    // peek never reads past the end of the current packet (and carried bits)
+    if constexpr (S == stream_direction::forward)
+    {
+        if (((readPosition_ + codeSize) <= peekEnd_) && (readPosition_ <= maxSafeReadPosition_))
+            return pop(readPosition_, codeSize);
+    }
+    else
+    {
+        if (((readPosition_ - codeSize) >= peekEnd_) && ((readPosition_ - codeSize) <= maxSafeReadPosition_))
+            return pop(readPosition_ - codeSize, codeSize);
+    }
+    statistics_.count_peek_miss();
+    return std::nullopt;
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S, typename Source>
+template <typename maniscalco::io::basic_pop_stream<S, Source>::size_type N>
+inline auto maniscalco::io::basic_pop_stream<S, Source>::pop
+(
+    // extract N bits starting at 'where'.  the shifts are constant and the
+    // ninth byte is only ever read for N > 57.
+    size_type where
 ) const -> code_type
 {
-    auto code = *(std::size_t *)(buffer_.data() + (where >> 0x03));
-    code = endian_swap<std::endian::big, std::endian::native>(code);
-    code >>= ((sizeof(std::size_t) << 3) - codeSize - (where & 0x07));
-    return (code & ((1ull << codeSize) - 1));
+    static_assert((N > 0) && (N <= 64), "pop_stream: code size must be in the range [1, 64]");
+    auto source = (buffer_.data() + (where >> 0x03));
+    auto offset = (where & 0x07);
+    std::uint64_t code;
+    std::memcpy(&code, source, sizeof(code));
+    code = (endian_swap<std::endian::big, std::endian::native>(code) << offset);
+    if constexpr (N > 57)
+        if ((offset + N) > 64)
+            code |= (source[sizeof(code)] >> (bits_per_byte - offset));
+    return (code >> (64 - N));
 }
 
 
 //=============================================================================
-template <>
-inline auto maniscalco::io::forward_pop_stream::pop
+template <maniscalco::io::stream_direction S, typename Source>
+template <typename maniscalco::io::basic_pop_stream<S, Source>::size_type N>
+inline auto maniscalco::io::basic_pop_stream<S, Source>::pop
 (
-    size_type codeLength
+    // code size known at compile time
 ) -> code_type
 {
-    auto nextReadPosition = (readPosition_ + codeLength);
-    if (nextReadPosition <= endCurrentBuffer_) 
+    if constexpr (S == stream_direction::forward)
     {
-        auto code = pop(readPosition_, codeLength);
-        readPosition_ = nextReadPosition;
-        return code;
+        if (auto nextReadPosition = (readPosition_ + N); nextReadPosition <= popEnd_)
+        {
+            auto code = pop<N>(readPosition_);
+            readPosition_ = nextReadPosition;
+            return code;
+        }
     }
-    else 
+    else
     {
-        size_type n = (endCurrentBuffer_ - readPosition_);
-        code_type code = (n > 0) ? code = pop(readPosition_, n) : 0;
-        load_input_buffer();
-        auto bits_remaining = (codeLength - n);
-        code <<= bits_remaining;
-        code |= pop(readPosition_, bits_remaining);
-        readPosition_ += bits_remaining;
-        return code;
+        if (auto nextReadPosition = (readPosition_ - N); (nextReadPosition >= endCurrentBuffer_) && (nextReadPosition <= maxSafeReadPosition_))
+            return pop<N>(readPosition_ = nextReadPosition);
     }
+    return pop(N); // code straddles packets (or is near the end of a buffer without slack)
 }
 
 
 //=============================================================================
-template <>
-inline auto maniscalco::io::reverse_pop_stream::pop
+template <maniscalco::io::stream_direction S, typename Source>
+template <typename maniscalco::io::basic_pop_stream<S, Source>::size_type N>
+inline auto maniscalco::io::basic_pop_stream<S, Source>::peek
 (
-    size_type codeLength
-) -> code_type
+    // code size known at compile time
+) const -> std::optional<code_type>
 {
-    // TODO
-    auto nextReadPosition = (readPosition_ - codeLength);
-    if (nextReadPosition >= endCurrentBuffer_) 
+    if constexpr (S == stream_direction::forward)
     {
-        auto code = pop(readPosition_ = nextReadPosition, codeLength);
-        return code;
+        if (((readPosition_ + N) <= peekEnd_) && (readPosition_ <= maxSafeReadPosition_))
+            return pop<N>(readPosition_);
     }
-    else 
+    else
     {
-        size_type n = (readPosition_ -= endCurrentBuffer_);
-        code_type code = (n > 0) ? code = pop(endCurrentBuffer_, n) : 0;
+        if (((readPosition_ - N) >= peekEnd_) && ((readPosition_ - N) <= maxSafeReadPosition_))
+            return pop<N>(readPosition_ - N);
+    }
+    statistics_.count_peek_miss();
+    return std::nullopt;
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S, typename Source>
+inline auto maniscalco::io::basic_pop_stream<S, Source>::statistics
+(
+) const -> stream_statistics requires (statistics_enabled)
+{
+    return statistics_.snapshot(size_consumed());
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S, typename Source>
+maniscalco::io::basic_pop_stream<S, Source>::basic_pop_stream
+(
+    configuration_type const & configuration
+): 
+    inputHandler_(configuration.inputHandler_),
+    randomAccessInputHandler_(configuration.randomAccessInputHandler_),
+    packetIndex_(configuration.packetIndex_),
+    carryOver_(configuration.carryOver_)
+{
+    // so that peek is valid at the start of the stream too
+    if (carryOver_)
         load_input_buffer();
-        auto bits_remaining = (codeLength - n);
-        code <<= bits_remaining;
-        readPosition_ -= bits_remaining;
-        code |= pop(readPosition_, bits_remaining);
-        return code;
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S, typename Source>
+auto maniscalco::io::basic_pop_stream<S, Source>::next_packet
+(
+    // request the next packet from the input handler
+) -> packet_type
+{
+    auto packetNumber = nextPacketNumber_++;
+    if ((randomAccessInputHandler_) && (packetIndex_) && (packetNumber >= packetIndex_->packet_count()))
+        return {};
+    auto packet = statistics_.time_handler([&]()
+            {
+                return (randomAccessInputHandler_) ? randomAccessInputHandler_(packetNumber) : inputHandler_();
+            });
+    if (packet.size() > 0)
+        statistics_.count_packet(); // not the empty packet ending the stream
+    return packet;
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S, typename Source>
+void maniscalco::io::basic_pop_stream<S, Source>::update_read_limits
+(
+)
+{
+    maxSafeReadPosition_ = ((buffer_.capacity() + buffer_.slack() - (size_type)sizeof(code_type) - 1) * bits_per_byte);
+    popEnd_ = std::min(endCurrentBuffer_, maxSafeReadPosition_);
+    peekEnd_ = endCurrentBuffer_;
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S, typename Source>
+void maniscalco::io::basic_pop_stream<S, Source>::set_packet
+(
+    packet_type packet
+)
+{
+    buffer_ = std::move(packet.buffer_);
+    endCurrentBuffer_ = packet.endOffset_;
+    readPosition_ = beginCurrentBuffer_ = packet.startOffset_;
+    update_read_limits();
+    if (carryOver_)
+        carry_over();
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S, typename Source>
+void maniscalco::io::basic_pop_stream<S, Source>::carry_over
+(
+    // read ahead now and copy the next 64 bits of the stream into the buffer
+    // immediately after the bits of the current packet.  packets shorter than
+    // 64 bits are followed by bits of the packets after them and the end of 
+    // the stream by zeros.  the bits are written into the slack when the 
+    // packet fills its buffer so a buffer without slack is first copied to 
+    // one with slack.
+)
+{
+    static auto constexpr bits_per_word = 64;
+    auto get_bit = [](std::uint8_t const * data, size_type position)
+            {
+                return ((data[position >> 3] & (0x80 >> (position & 0x07))) != 0);
+            };
+    auto set_bit = [](std::uint8_t * data, size_type position, bool value)
+            {
+                auto mask = (std::uint8_t)(0x80 >> (position & 0x07));
+                data[position >> 3] = (value) ? (data[position >> 3] | mask) : (data[position >> 3] & ~mask);
+            };
+
+    if (endCurrentBuffer_ == beginCurrentBuffer_)
+    {
+        // end of the stream.  peek returns zeros.
+        buffer_ = buffer(sizeof(code_type));
+        std::memset(buffer_.data(), 0x00, sizeof(code_type));
+        readPosition_ = beginCurrentBuffer_ = endCurrentBuffer_ = 0;
+        update_read_limits();
+        peekEnd_ = (S == stream_direction::forward) ? bits_per_word : -bits_per_word;
+        return;
+    }
+    if (buffer_.slack() < buffer::slack_size)
+    {
+        buffer copy(buffer_.capacity());
+        std::memcpy(copy.data(), buffer_.data(), buffer_.capacity());
+        buffer_ = std::move(copy);
+        update_read_limits();
+    }
+    size_type count = 0;
+    for (std::size_t i = 0; count < bits_per_word; ++i)
+    {
+        if (i == lookAhead_.size())
+            lookAhead_.emplace_back(next_packet());
+        auto const & next = lookAhead_[i];
+        auto available = (size_type)next.size();
+        if (available == 0)
+            break; // end of the stream (the source is not called again)
+        auto n = std::min<size_type>(available, bits_per_word - count);
+        for (auto j = 0; j < n; ++j)
+        {
+            if constexpr (S == stream_direction::forward)
+                set_bit(buffer_.data(), endCurrentBuffer_ + count + j, get_bit(next.data(), next.startOffset_ + j));
+            else
+                set_bit(buffer_.data(), endCurrentBuffer_ - count - n + j, get_bit(next.data(), next.startOffset_ - n + j));
+        }
+        count += n;
+    }
+    for (; count < bits_per_word; ++count)
+    {
+        if constexpr (S == stream_direction::forward)
+            set_bit(buffer_.data(), endCurrentBuffer_ + count, false);
+        else
+            set_bit(buffer_.data(), endCurrentBuffer_ - count - 1, false);
     }
+    peekEnd_ = (S == stream_direction::forward) ? (endCurrentBuffer_ + bits_per_word) : (endCurrentBuffer_ - bits_per_word);
 }
 
 
 //=============================================================================
-template <>
-inline auto maniscalco::io::forward_pop_stream::peek
+template <maniscalco::io::stream_direction S, typename Source>
+auto maniscalco::io::basic_pop_stream<S, Source>::pop_safe
 (
+    size_type where, 
     size_type codeSize
-) const -> std::optional<code_type>
+) const -> code_type
 {
-    return (readPosition_ <= maxSafePeekPosition_) ? 
-            std::optional<code_type>(pop(readPosition_, codeSize)) : std::nullopt;
+    code_type code = 0;
+    while (codeSize > 0)
+    {
+        auto offset = (where & 0x07);
+        auto n = std::min<size_type>(bits_per_byte - offset, codeSize);
+        auto index = (where >> 3);
+        std::uint8_t byte = ((index >= 0) && (index < buffer_.capacity())) ? buffer_.data()[index] : 0;
+        code = ((code << n) | ((byte >> (bits_per_byte - offset - n)) & ((1u << n) - 1)));
+        where += n;
+        codeSize -= n;
+    }
+    return code;
 }
 
 
 //=============================================================================
-template <>
-inline auto maniscalco::io::reverse_pop_stream::peek
+template <maniscalco::io::stream_direction S, typename Source>
+void maniscalco::io::basic_pop_stream<S, Source>::seek
 (
+    // position the stream at 'position' bits from the start of the stream.
+    // the packet containing that position is requested from the random 
+    // access input handler using the packet index.
+    size_type position
+)
+{
+    if ((!randomAccessInputHandler_) || (!packetIndex_))
+        throw std::runtime_error("pop_stream::seek: random access input handler and packet index are required");
+    if ((position < 0) || (position > packetIndex_->size()))
+        throw std::runtime_error("pop_stream::seek: position is beyond the end of the stream");
+
+    auto packetNumber = packetIndex_->find(position);
+    auto currentPacketNumber = (nextPacketNumber_ - (size_type)lookAhead_.size() - 1);
+    if (packetNumber != currentPacketNumber)
+    {
+        lookAhead_.clear();
+        nextPacketNumber_ = packetNumber;
+        set_packet(next_packet());
+    }
+    sizeConsumed_ = packetIndex_->bit_offset(packetNumber);
+    if constexpr (S == stream_direction::forward)
+        readPosition_ = beginCurrentBuffer_ + (position - sizeConsumed_);
+    else
+        readPosition_ = beginCurrentBuffer_ - (position - sizeConsumed_);
+}
+
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S, typename Source>
+template <typename T>
+void maniscalco::io::basic_pop_stream<S, Source>::pop_n
+(
+    // pop codes.size() codes all of the same code size.
+    // equivalent to calling pop() for each code in turn.
+    std::span<T> codes,
     size_type codeSize
-) const -> std::optional<code_type>
+)
 {
-    return ((codeSize <= readPosition_) && (readPosition_ <= maxSafePeekPosition_)) ? 
-            std::optional<code_type>(pop(readPosition_ - codeSize, codeSize)) : std::nullopt;
+    static auto constexpr codes_per_block = 64;
+    static auto constexpr bits_per_word = 64;
+    using word_type = std::uint64_t;
+
+    auto current = codes.data();
+    auto end = current + codes.size();
+    if (codeSize <= 0)
+    {
+        std::fill(current, end, 0);
+        return;
+    }
+    if (codeSize > (size_type)(sizeof(T) * bits_per_byte))
+        throw std::runtime_error("pop_stream::pop_n: code size exceeds the width of the code type");
+    auto unpackBlock = select_unpack_block<S, T>(codeSize);
+    auto bitsPerBlock = (codeSize * bits_per_word);
+    auto block_fits = [&]()
+            {
+                // block must lie within the current packet and loading it 
+                // must not read beyond the end of the buffer
+                auto blockStart = (S == stream_direction::forward) ? readPosition_ : (readPosition_ - bitsPerBlock);
+                auto blockEnd = (blockStart + bitsPerBlock);
+                auto inPacket = (S == stream_direction::forward) ? (blockEnd <= endCurrentBuffer_) : (blockStart >= endCurrentBuffer_);
+                auto loadEnd = (blockStart / bits_per_byte) + (codeSize * (size_type)sizeof(word_type)) + 
+                        (((blockStart % bits_per_byte) != 0) ? (size_type)sizeof(word_type) : 0);
+                return ((inPacket) && (blockStart >= 0) && (loadEnd <= (buffer_.capacity() + buffer_.slack())));
+            };
+
+    while ((end - current) >= codes_per_block)
+    {
+        if (block_fits())
+        {
+            do
+            {
+                if constexpr (S == stream_direction::forward)
+                {
+                    unpackBlock(buffer_.data(), readPosition_, current);
+                    readPosition_ += bitsPerBlock;
+                }
+                else
+                {
+                    readPosition_ -= bitsPerBlock;
+                    unpackBlock(buffer_.data(), readPosition_, current);
+                }
+                current += codes_per_block;
+            } while (((end - current) >= codes_per_block) && (block_fits()));
+        }
+        else
+        {
+            // block crosses a packet boundary
+            for (auto i = 0; i < codes_per_block; ++i)
+                *current++ = (T)pop(codeSize);
+        }
+    }
+    // remaining codes
+    while (current < end)
+        *current++ = (T)pop(codeSize);
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S, typename Source>
+inline void maniscalco::io::basic_pop_stream<S, Source>::store_bits
+(
+    std::uint8_t * destination, 
+    size_type position,
+    code_type code,
+    size_type count
+)
+{
+    while (count > 0)
+    {
+        auto offset = (position & 0x07);
+        auto n = std::min<size_type>(bits_per_byte - offset, count);
+        auto shift = (bits_per_byte - offset - n);
+        auto mask = (std::uint8_t)(((1u << n) - 1) << shift);
+        auto bits = (std::uint8_t)(((code >> (count - n)) << shift) & mask);
+        auto & byte = destination[position >> 3];
+        byte = ((byte & ~mask) | bits);
+        position += n;
+        count -= n;
+    }
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S, typename Source>
+void maniscalco::io::basic_pop_stream<S, Source>::pop_bits
+(
+    // bit exact with popping the bits one at a time.  forward streams fill
+    // the destination from bit 0 upwards and reverse streams from bit 
+    // count - 1 downwards.  whole words are popped and stored and, when the
+    // read position is at a byte boundary, whole bytes of the current packet
+    // are copied directly.
+    std::uint8_t * destination, 
+    size_type count
+)
+{
+    static auto constexpr bits_per_word = 64;
+    using word_type = std::uint64_t;
+
+    auto store_word = [&](size_type position, word_type word)
+            {
+                // position is a multiple of 8
+                word = endian_swap<std::endian::native, std::endian::big>(word);
+                std::memcpy(destination + (position / bits_per_byte), &word, sizeof(word));
+            };
+
+    if (count <= 0)
+        return;
+    if constexpr (S == stream_direction::forward)
+    {
+        size_type position = 0;
+        while ((count - position) >= bits_per_word)
+        {
+            if ((readPosition_ & 0x07) == 0)
+            {
+                if (auto n = std::min((count - position), (endCurrentBuffer_ - readPosition_)) / bits_per_byte; n > 0)
+                {
+                    std::memcpy(destination + (position / bits_per_byte), buffer_.data() + (readPosition_ / bits_per_byte), n);
+                    readPosition_ += (n * bits_per_byte);
+                    position += (n * bits_per_byte);
+                    continue;
+                }
+            }
+            else if (auto words = std::min((count - position), (popEnd_ - readPosition_)) / bits_per_word; words > 0)
+            {
+                // whole words which lie within the current packet.  the read
+                // position is not byte aligned here.
+                auto input = (buffer_.data() + (readPosition_ / bits_per_byte));
+                auto shift = (readPosition_ & 0x07);
+                for (auto i = 0; i < words; ++i)
+                {
+                    word_type word;
+                    std::memcpy(&word, input, sizeof(word));
+                    word = ((endian_swap<std::endian::big, std::endian::native>(word) << shift) | 
+                            (input[sizeof(word)] >> (bits_per_byte - shift)));
+                    store_word(position, word);
+                    input += sizeof(word);
+                    position += bits_per_word;
+                }
+                readPosition_ += (words * bits_per_word);
+                continue;
+            }
+            store_word(position, pop(bits_per_word));
+            position += bits_per_word;
+        }
+        if (auto n = (count - position); n > 0)
+            store_bits(destination, position, pop(n), n);
+    }
+    else
+    {
+        auto top = count;
+        if (auto n = (top & 0x07); n > 0)
+        {
+            // bring the destination to a byte boundary
+            store_bits(destination, top - n, pop(n), n);
+            top -= n;
+        }
+        while (top >= bits_per_word)
+        {
+            if ((readPosition_ & 0x07) == 0)
+            {
+                if (auto n = std::min(top, (readPosition_ - endCurrentBuffer_)) / bits_per_byte; n > 0)
+                {
+                    readPosition_ -= (n * bits_per_byte);
+                    top -= (n * bits_per_byte);
+                    std::memcpy(destination + (top / bits_per_byte), buffer_.data() + (readPosition_ / bits_per_byte), n);
+                    continue;
+                }
+            }
+            else if (auto words = std::min(top, (readPosition_ - endCurrentBuffer_)) / bits_per_word; 
+                    (words > 0) && ((readPosition_ - bits_per_word) <= maxSafeReadPosition_))
+            {
+                // whole words which lie within the current packet.  the read
+                // position is not byte aligned here.
+                auto input = (buffer_.data() + (readPosition_ / bits_per_byte));
+                auto shift = (readPosition_ & 0x07);
+                for (auto i = 0; i < words; ++i)
+                {
+                    input -= sizeof(word_type);
+                    word_type word;
+                    std::memcpy(&word, input, sizeof(word));
+                    word = ((endian_swap<std::endian::big, std::endian::native>(word) << shift) | 
+                            (input[sizeof(word)] >> (bits_per_byte - shift)));
+                    top -= bits_per_word;
+                    store_word(top, word);
+                }
+                readPosition_ -= (words * bits_per_word);
+                continue;
+            }
+            top -= bits_per_word;
+            store_word(top, pop(bits_per_word));
+        }
+        if (top > 0)
+            store_bits(destination, 0, pop(top), top);
+    }
 }
+
+namespace maniscalco::io
+{
+    // compiled once in pop_stream.cpp
+    extern template class basic_pop_stream<stream_direction::forward, std::function<stream_packet<stream_direction::forward>()>>;
+    extern template class basic_pop_stream<stream_direction::reverse, std::function<stream_packet<stream_direction::reverse>()>>;
+
+} // maniscalco::io
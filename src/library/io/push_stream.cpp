@@ -1,76 +1,126 @@
 #include "./push_stream.h"
 
+#include <array>
+#include <cstring>
+#include <utility>
 
-//=============================================================================
-template <>
-maniscalco::io::forward_push_stream::push_stream
-(
-    configuration_type const & configuration
-): 
-    bufferAllocationHandler_(configuration.bufferAllocationHandler_ ? configuration.bufferAllocationHandler_ : 
-            [](){return buffer(default_buffer_size);}),
-    buffer_(bufferAllocationHandler_()),
-    writePosition_(buffer_.begin()),
-    bufferOutputHandler_(configuration.bufferOutputHandler_),
-    size_(0),
-    internalSize_(0),
-    internalBuffer_{0,0}
+
+namespace
 {
-}
 
+    using code_type = std::uint64_t;
+    using word_type = std::uint64_t;
+    using maniscalco::io::pack_block_function;
 
-//=============================================================================
-template <>
-maniscalco::io::reverse_push_stream::push_stream
-(
-    configuration_type const & configuration
-): 
-    bufferAllocationHandler_(configuration.bufferAllocationHandler_ ? configuration.bufferAllocationHandler_ : 
-            [](){return buffer(default_buffer_size);}),
-    buffer_(bufferAllocationHandler_()),
-    writePosition_(buffer_.end()),
-    bufferOutputHandler_(configuration.bufferOutputHandler_),
-    size_(0),
-    internalSize_(0),
-    internalBuffer_{0,0}
-{
-}
+    // push_n packs codes in blocks of 64.  a block of 64 codes of width W
+    // always occupies exactly W 64 bit words so each block leaves the bit 
+    // offset within the stream unchanged and every shift is a compile time 
+    // constant.
+    static auto constexpr codes_per_block = 64;
+    static auto constexpr bits_per_word = 64;
 
 
-//=============================================================================
-template <maniscalco::io::stream_direction S>
-maniscalco::io::push_stream<S>::~push_stream
-(
-)
-{
-    flush();
-}
+    //=========================================================================
+    template <std::size_t W, std::size_t I>
+    inline void pack_code_forward
+    (
+        // place code I of the block msb first (forward stream order)
+        code_type code, 
+        word_type * words
+    )
+    {
+        static auto constexpr position = (I * W);
+        static auto constexpr index = (position / bits_per_word);
+        static auto constexpr offset = (position % bits_per_word);
+        if constexpr ((offset + W) <= bits_per_word)
+        {
+            words[index] |= (code << (bits_per_word - offset - W));
+        }
+        else
+        {
+            words[index] |= (code >> (offset + W - bits_per_word));
+            words[index + 1] |= (code << ((2 * bits_per_word) - offset - W));
+        }
+    }
 
 
-//=============================================================================
-template <>
-auto maniscalco::io::forward_push_stream::size
-(
-) const -> size_type
-{
-    return (size_ + ((writePosition_ - buffer_.begin()) * bits_per_byte) + internalSize_);
-}
+    //=========================================================================
+    template <std::size_t W, std::size_t I>
+    inline void pack_code_reverse
+    (
+        // place code I of the block lsb first (reverse stream order).
+        // word 0 is the word nearest the end of the buffer.
+        code_type code, 
+        word_type * words
+    )
+    {
+        static auto constexpr position = (I * W);
+        static auto constexpr index = (position / bits_per_word);
+        static auto constexpr offset = (position % bits_per_word);
+        if constexpr ((offset + W) <= bits_per_word)
+        {
+            words[index] |= (code << offset);
+        }
+        else
+        {
+            words[index] |= (code << offset);
+            words[index + 1] |= (code >> (bits_per_word - offset));
+        }
+    }
+
+
+    //=========================================================================
+    template <maniscalco::io::stream_direction S, std::size_t W>
+    void pack_block
+    (
+        code_type const * codes, 
+        word_type * words
+    )
+    {
+        std::fill(words, words + W, 0);
+        [&]<std::size_t ... I>(std::index_sequence<I ...>)
+        {
+            if constexpr (S == maniscalco::io::stream_direction::forward)
+                (pack_code_forward<W, I>(codes[I], words), ...);
+            else
+                (pack_code_reverse<W, I>(codes[I], words), ...);
+        }(std::make_index_sequence<codes_per_block>());
+    }
+
+
+    //=========================================================================
+    template <maniscalco::io::stream_direction S>
+    auto constexpr pack_block_table = []<std::size_t ... W>(std::index_sequence<W ...>)
+            {
+                // index by code width.  width 0 is never dispatched
+                return std::array<pack_block_function, sizeof ... (W) + 1>{nullptr, &pack_block<S, W + 1> ...};
+            }(std::make_index_sequence<bits_per_word>());
+
+} // namespace
+
 
 
 //=============================================================================
-template <>
-auto maniscalco::io::reverse_push_stream::size
+template <maniscalco::io::stream_direction S>
+auto maniscalco::io::select_pack_block
 (
-) const -> size_type
+    // 0 < codeSize <= 64
+    std::int64_t codeSize
+) -> pack_block_function
 {
-    return (size_ + ((buffer_.end() - writePosition_) * bits_per_byte) + internalSize_);
+    return pack_block_table<S>[codeSize];
 }
 
 
 //=============================================================================
 namespace maniscalco::io
 {
-    template class push_stream<stream_direction::forward>;
-    template class push_stream<stream_direction::reverse>;
+    template pack_block_function select_pack_block<stream_direction::forward>(std::int64_t);
+    template pack_block_function select_pack_block<stream_direction::reverse>(std::int64_t);
+
+    template class basic_push_stream<stream_direction::forward, 
+            std::function<void(stream_packet<stream_direction::forward>)>, std::function<buffer()>>;
+    template class basic_push_stream<stream_direction::reverse, 
+            std::function<void(stream_packet<stream_direction::reverse>)>, std::function<buffer()>>;
 
 } // maniscalco
\ No newline at end of file
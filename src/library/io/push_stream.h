@@ -3,6 +3,7 @@
 #include "./buffer.h"
 #include "./stream_direction.h"
 #include "./stream_packet.h"
+#include "./stream_statistics.h"
 
 #include <cstdint>
 #include <functional>
@@ -10,13 +11,45 @@
 #include <memory>
 #include <vector>
 #include <tuple>
+#include <span>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
 
 
 namespace maniscalco::io
 {
 
+    // packs a block of 64 codes into as many 64 bit words as the code width.
+    // defined in push_stream.cpp so that the table of all 64 widths is only
+    // compiled once.
+    using pack_block_function = void(*)(std::uint64_t const *, std::uint64_t *);
+
     template <stream_direction S>
-    class push_stream final 
+    pack_block_function select_pack_block
+    (
+        std::int64_t
+    );
+
+
+    // allocates buffers of the default size.  an empty type so that a stream
+    // using it stores no allocation handler at all.
+    struct default_buffer_allocator
+    {
+        static buffer::size_type constexpr buffer_size = ((1 << 10) * 8);
+
+        buffer operator()() const{return buffer(buffer_size);}
+    };
+
+
+    // the output handler (Sink) and allocation handler (Allocator) are policy 
+    // types which are called directly and can be inlined.  Sink is any type 
+    // callable as void(stream_packet<S>) and Allocator any type callable as 
+    // buffer().  empty policies occupy no storage.  push_stream<S> is the
+    // instantiation using std::function handlers.
+    template <stream_direction S, typename Sink, typename Allocator = default_buffer_allocator>
+    class basic_push_stream final 
     {
     public:
 
@@ -25,31 +58,37 @@ namespace maniscalco::io
         using size_type = std::int64_t;
         using packet_type = stream_packet<S>;
 
-        static size_type constexpr default_buffer_size = ((1 << 10) * 8);
+        static size_type constexpr default_buffer_size = default_buffer_allocator::buffer_size;
+
+        static size_type constexpr record_count_header_size = 32;
 
 
-        using buffer_allocation_handler = std::function<buffer()>;
-        using buffer_output_handler = std::function<void(packet_type)>;
+        using buffer_allocation_handler = Allocator;
+        using buffer_output_handler = Sink;
 
         struct configuration_type 
         {
             buffer_output_handler bufferOutputHandler_;
+            // an empty std::function selects default_buffer_allocator
             buffer_allocation_handler bufferAllocationHandler_;
+            // when set each packet begins with a 32 bit count of the records 
+            // started in that packet (see begin_record)
+            bool recordCountHeader_{false};
         };
 
-        push_stream() = default;
+        basic_push_stream() = default;
 
-        push_stream(configuration_type const &);
+        basic_push_stream(configuration_type const &);
 
-        push_stream(push_stream &&) = default;
+        basic_push_stream(basic_push_stream &&) = default;
 
-        push_stream & operator = (push_stream &&) = default;
+        basic_push_stream & operator = (basic_push_stream &&) = default;
 
-        // push_stream is non-copyable - move only
-        push_stream(push_stream const &) = delete;
-        push_stream & operator = (push_stream const &) = delete;
+        // basic_push_stream is non-copyable - move only
+        basic_push_stream(basic_push_stream const &) = delete;
+        basic_push_stream & operator = (basic_push_stream const &) = delete;
 
-        ~push_stream();
+        ~basic_push_stream();
 
         void push
         (
@@ -57,32 +96,98 @@ namespace maniscalco::io
             size_type
         );
 
+        // code size known at compile time
+        template <size_type N>
+        void push
+        (
+            code_type
+        );
+
+        // 0 < code size <= 64 (throws if greater)
+        void push_n
+        (
+            std::span<code_type const>, 
+            size_type
+        );
+
+        // copy 'count' bits starting 'offset' bits into the source (msb first
+        // within each byte).  forward streams take the bits in increasing
+        // order and reverse streams from offset + count - 1 downwards, so a
+        // range copied out of a packet keeps its layout either way.
+        void push_bits
+        (
+            std::uint8_t const *, 
+            size_type,
+            size_type
+        );
+
         size_type size() const;
 
+        // packet aligned output.  ensures that the next 'recordSize' bits are
+        // written to a single packet, flushing the current packet first if 
+        // there is not enough room.  so long as every code is pushed within a
+        // record no code crosses a packet boundary and each packet can be 
+        // decoded independently.
+        void begin_record
+        (
+            size_type
+        );
+
         void flush();
 
         void align();
 
+        // requires IO_ENABLE_STATISTICS
+        stream_statistics statistics() const requires (statistics_enabled);
+
     private:
 
         void flush_current_buffer();
 
-        buffer_allocation_handler bufferAllocationHandler_;
+        void spill
+        (
+            code_type, 
+            size_type, 
+            size_type
+        );
+
+        // write any whole bytes held in the accumulator
+        bool drain_accumulator();
+
+        static code_type load_bits
+        (
+            std::uint8_t const *, 
+            size_type, 
+            size_type
+        );
+
+        [[no_unique_address]] buffer_allocation_handler bufferAllocationHandler_;
 
         buffer buffer_;
 
         buffer::iterator writePosition_;
 
-        buffer_output_handler bufferOutputHandler_;
+        [[no_unique_address]] buffer_output_handler bufferOutputHandler_;
 
         size_type size_{0};
 
-        std::uint32_t internalBuffer_[2] = {0, 0};
+        // bits not yet written to buffer_.  msb aligned for forward streams,
+        // lsb aligned for reverse streams.  always fewer than 64 bits.
+        std::uint64_t accumulator_{0};
+
+        size_type accumulatorSize_{0};
 
-        size_type internalSize_{0};
+        bool recordCountHeader_{false};
 
-    }; // class push_stream
+        std::uint32_t recordCount_{0};
 
+        [[no_unique_address]] stream_statistics_recorder<> statistics_;
+
+    }; // class basic_push_stream
+
+
+    template <stream_direction S>
+    using push_stream = basic_push_stream<S, std::function<void(stream_packet<S>)>, std::function<buffer()>>;
 
     using forward_push_stream = push_stream<stream_direction::forward>;
     using reverse_push_stream = push_stream<stream_direction::reverse>;
@@ -91,146 +196,552 @@ namespace maniscalco::io
 
 
 //=============================================================================
-template <maniscalco::io::stream_direction S>
-inline void maniscalco::io::push_stream<S>::flush
+template <maniscalco::io::stream_direction S, typename Sink, typename Allocator>
+maniscalco::io::basic_push_stream<S, Sink, Allocator>::basic_push_stream
 (
-)
+    configuration_type const & configuration
+): 
+    bufferAllocationHandler_(configuration.bufferAllocationHandler_),
+    bufferOutputHandler_(configuration.bufferOutputHandler_),
+    recordCountHeader_(configuration.recordCountHeader_)
 {
-    flush_current_buffer();
+    if constexpr (std::is_same_v<Allocator, std::function<buffer()>>)
+        if (!bufferAllocationHandler_)
+            bufferAllocationHandler_ = default_buffer_allocator();
+    buffer_ = statistics_.time_allocation([&](){return bufferAllocationHandler_();});
+    writePosition_ = (S == stream_direction::forward) ? buffer_.begin() : buffer_.end();
 }
 
 
 //=============================================================================
-template <>
-inline void maniscalco::io::forward_push_stream::flush_current_buffer
+template <maniscalco::io::stream_direction S, typename Sink, typename Allocator>
+maniscalco::io::basic_push_stream<S, Sink, Allocator>::~basic_push_stream
 (
 )
 {
-    auto bitsToFlush = (internalSize_ + ((writePosition_ - buffer_.begin()) * bits_per_byte));
-    if (bitsToFlush > 0)
+    // a moved from stream has no buffer and nothing to flush.  an error from
+    // the final flush cannot be reported here - call flush() first to see it.
+    if (buffer_)
     {
-        if (internalSize_ > 0)
+        try
         {
-            // ensure that any internally buffered bits are also flushed
-            using output_type = std::uint32_t;
-            *(output_type *)(writePosition_) = internalBuffer_[0];
-            internalBuffer_[0] = 0x00;
-            internalBuffer_[1] = 0x00;
-            internalSize_ = 0;
+            flush();
         }
-        size_ += bitsToFlush;
-        bufferOutputHandler_({std::move(buffer_), 0, bitsToFlush});
-        buffer_ = bufferAllocationHandler_();
-        writePosition_ = buffer_.begin();
+        catch (...)
+        {
+        }
+    }
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S, typename Sink, typename Allocator>
+auto maniscalco::io::basic_push_stream<S, Sink, Allocator>::size
+(
+) const -> size_type
+{
+    if constexpr (S == stream_direction::forward)
+        return (size_ + ((writePosition_ - buffer_.begin()) * bits_per_byte) + accumulatorSize_);
+    else
+        return (size_ + ((buffer_.end() - writePosition_) * bits_per_byte) + accumulatorSize_);
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S, typename Sink, typename Allocator>
+inline void maniscalco::io::basic_push_stream<S, Sink, Allocator>::flush
+(
+)
+{
+    flush_current_buffer();
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S, typename Sink, typename Allocator>
+inline void maniscalco::io::basic_push_stream<S, Sink, Allocator>::begin_record
+(
+    size_type recordSize
+)
+{
+    // push() flushes a buffer once fewer than one word remains so a packet
+    // holds at most one word per whole word of buffer capacity
+    auto packetCapacity = (size_type)((buffer_.capacity() / sizeof(code_type)) * 64);
+    auto packetSize = (size() - size_);
+    auto headerSize = (recordCountHeader_ && (packetSize == 0)) ? record_count_header_size : 0;
+    if ((packetSize + headerSize + recordSize) > packetCapacity)
+    {
+        flush_current_buffer();
+        packetCapacity = (size_type)((buffer_.capacity() / sizeof(code_type)) * 64);
+        headerSize = recordCountHeader_ ? record_count_header_size : 0;
+        if ((headerSize + recordSize) > packetCapacity)
+            throw std::runtime_error("push_stream::begin_record: record is larger than a packet");
+    }
+    if (headerSize > 0)
+        push(0, headerSize);
+    ++recordCount_;
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S, typename Sink, typename Allocator>
+inline void maniscalco::io::basic_push_stream<S, Sink, Allocator>::align
+(
+    // align bit stream to next byte boundary
+)
+{
+    if (auto n = ((bits_per_byte - (accumulatorSize_ & 0x07)) & 0x07); n > 0)
+    {
+        statistics_.count_align_padding(n);
+        push(0, n);
     }
 }
 
 
 //=============================================================================
-template <>
-inline void maniscalco::io::reverse_push_stream::flush_current_buffer
+template <maniscalco::io::stream_direction S, typename Sink, typename Allocator>
+inline auto maniscalco::io::basic_push_stream<S, Sink, Allocator>::statistics
+(
+) const -> stream_statistics requires (statistics_enabled)
+{
+    return statistics_.snapshot(size());
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S, typename Sink, typename Allocator>
+inline void maniscalco::io::basic_push_stream<S, Sink, Allocator>::flush_current_buffer
 (
 )
 {
-    auto bitsToFlush = (internalSize_ + ((buffer_.end() - writePosition_) * bits_per_byte));
+    auto bitsToFlush = (accumulatorSize_ + (((S == stream_direction::forward) ? 
+            (writePosition_ - buffer_.begin()) : (buffer_.end() - writePosition_)) * bits_per_byte));
     if (bitsToFlush > 0)
     {
-        if (internalSize_ > 0)
+        if (accumulatorSize_ > 0)
         {
-            // ensure that any internally buffered bits are also flushed
-            using output_type = std::uint32_t;
-            writePosition_ -= sizeof(output_type);
-            *(output_type *)(writePosition_) = internalBuffer_[1];
-            internalBuffer_[0] = 0x00;
-            internalBuffer_[1] = 0x00;
-            internalSize_ = 0;
+            // ensure that any accumulated bits are also flushed.
+            // push() always leaves room for at least one more word.
+            auto word = endian_swap<std::endian::native, std::endian::big>(accumulator_);
+            if constexpr (S == stream_direction::forward)
+                std::memcpy(writePosition_, &word, sizeof(word));
+            else
+                std::memcpy(writePosition_ - sizeof(word), &word, sizeof(word));
+            accumulator_ = 0;
+            accumulatorSize_ = 0;
+        }
+        if (recordCountHeader_)
+        {
+            auto header = endian_swap<std::endian::native, std::endian::big>(std::exchange(recordCount_, 0));
+            if constexpr (S == stream_direction::forward)
+                std::memcpy(buffer_.data(), &header, sizeof(header));
+            else
+                std::memcpy(buffer_.end() - sizeof(header), &header, sizeof(header));
         }
         size_ += bitsToFlush;
-        auto bufferEndOffset = buffer_.capacity() * bits_per_byte;
-        bufferOutputHandler_({std::move(buffer_), bufferEndOffset, bufferEndOffset - bitsToFlush});
-        buffer_ = bufferAllocationHandler_();
-        writePosition_ = buffer_.end();
+        statistics_.count_packet();
+        if constexpr (S == stream_direction::forward)
+        {
+            statistics_.time_handler([&](){bufferOutputHandler_(packet_type{std::move(buffer_), 0, bitsToFlush});});
+            buffer_ = statistics_.time_allocation([&](){return bufferAllocationHandler_();});
+            writePosition_ = buffer_.begin();
+        }
+        else
+        {
+            auto bufferEndOffset = buffer_.capacity() * bits_per_byte;
+            statistics_.time_handler([&](){bufferOutputHandler_(packet_type{std::move(buffer_), bufferEndOffset, bufferEndOffset - bitsToFlush});});
+            buffer_ = statistics_.time_allocation([&](){return bufferAllocationHandler_();});
+            writePosition_ = buffer_.end();
+        }
     }
 }
 
 
 //=============================================================================
-template <>
-inline void maniscalco::io::forward_push_stream::push
+template <maniscalco::io::stream_direction S, typename Sink, typename Allocator>
+inline void maniscalco::io::basic_push_stream<S, Sink, Allocator>::spill
 (
-    // max codeSize = 32
+    // accumulator is full - write one word.
+    // forward: the low 'overflow' bits of code remain in the accumulator.
+    // reverse: the high 'overflow' bits of code remain in the accumulator.
+    code_type code, 
+    size_type codeSize,
+    size_type overflow
+)
+{
+    bool bufferFull;
+    if constexpr (S == stream_direction::forward)
+    {
+        auto word = endian_swap<std::endian::native, std::endian::big>(accumulator_ | (code >> overflow));
+        std::memcpy(writePosition_, &word, sizeof(word));
+        writePosition_ += sizeof(word);
+        accumulator_ = (overflow > 0) ? (code << (64 - overflow)) : 0;
+        bufferFull = ((buffer_.end() - writePosition_) < (std::int64_t)sizeof(word));
+    }
+    else
+    {
+        auto word = endian_swap<std::endian::native, std::endian::big>(accumulator_ | (code << accumulatorSize_));
+        writePosition_ -= sizeof(word);
+        std::memcpy(writePosition_, &word, sizeof(word));
+        accumulator_ = (overflow > 0) ? (code >> (codeSize - overflow)) : 0;
+        bufferFull = ((writePosition_ - buffer_.begin()) < (std::int64_t)sizeof(word));
+    }
+    accumulatorSize_ = overflow;
+    if (bufferFull)
+    {
+        // flush the full buffer but keep the overflow bits for the next buffer
+        if (overflow > 0)
+            statistics_.count_straddle();
+        auto temp = std::exchange(accumulatorSize_, 0);
+        flush_current_buffer();
+        accumulatorSize_ = temp;
+    }
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S, typename Sink, typename Allocator>
+inline void maniscalco::io::basic_push_stream<S, Sink, Allocator>::push
+(
+    // 0 < codeSize <= 64
     code_type code, 
     size_type codeSize
 )
 {
-    code <<= (64 - codeSize - internalSize_);
-    code = endian_swap<std::endian::native, std::endian::big>(code);
-    *(std::size_t *)(internalBuffer_) |= code;
-    internalSize_ += codeSize;
-    if (internalSize_ >= 32)
-    {
-        // TODO: what if write position + sizeof(output_type) > endWritePosition_ ??
-        using output_type = std::uint32_t;
-        *(output_type *)(writePosition_) = internalBuffer_[0];
-        internalBuffer_[0] = internalBuffer_[1];
-        internalBuffer_[1] = 0x00;
-        writePosition_ += sizeof(output_type);
-        internalSize_ -= (sizeof(output_type) * bits_per_byte);
-        if (writePosition_ >= buffer_.end())
-        {
-            // hack hides any remaining 'internal bits' during flush. figure out cleaner way
-            auto temp = internalSize_;
-            internalSize_ = 0;
-            flush_current_buffer();
-            internalSize_ = temp;
+    auto available = (64 - accumulatorSize_);
+    if (codeSize < available)
+    {
+        if constexpr (S == stream_direction::forward)
+            accumulator_ |= (code << (available - codeSize));
+        else
+            accumulator_ |= (code << accumulatorSize_);
+        accumulatorSize_ += codeSize;
+        return;
+    }
+    spill(code, codeSize, codeSize - available);
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S, typename Sink, typename Allocator>
+template <typename maniscalco::io::basic_push_stream<S, Sink, Allocator>::size_type N>
+inline void maniscalco::io::basic_push_stream<S, Sink, Allocator>::push
+(
+    // code size known at compile time.  a 64 bit code always fills the
+    // accumulator so the test for available space is eliminated.
+    code_type code
+)
+{
+    static_assert((N > 0) && (N <= 64), "push_stream: code size must be in the range [1, 64]");
+    if constexpr (N < 64)
+    {
+        if ((accumulatorSize_ + N) < 64)
+        {
+            if constexpr (S == stream_direction::forward)
+                accumulator_ |= ((code << (64 - N)) >> accumulatorSize_);
+            else
+                accumulator_ |= (code << accumulatorSize_);
+            accumulatorSize_ += N;
+            return;
         }
     }
+    spill(code, N, accumulatorSize_ + N - 64);
 }
 
 
 //=============================================================================
-template <>
-inline void maniscalco::io::reverse_push_stream::push
+template <maniscalco::io::stream_direction S, typename Sink, typename Allocator>
+void maniscalco::io::basic_push_stream<S, Sink, Allocator>::push_n
 (
-    // max codeSize = 32
-    code_type code, 
+    // push all codes using the same code size.  
+    // bit exact with calling push() for each code in turn.
+    std::span<code_type const> codes, 
     size_type codeSize
 )
 {
-    code <<= internalSize_;
-    code = endian_swap<std::endian::native, std::endian::big>(code);
-    *(std::size_t *)(internalBuffer_) |= code;
-    if ((internalSize_ += codeSize) >= 32)
-    {
-        // TODO: what if write position is < sizeof(output_type) ??
-        using output_type = std::uint32_t;
-        writePosition_ -= sizeof(output_type);
-        *(output_type *)(writePosition_) = internalBuffer_[1];
-        internalBuffer_[1] = internalBuffer_[0];
-        internalBuffer_[0] = 0x00;
-        internalSize_ -= (sizeof(output_type) * bits_per_byte);
-        if (writePosition_ <= buffer_.begin())
-        {
-            // hack hides any remaining 'internal bits' during flush. figure out cleaner way
-            auto temp = internalSize_;
-            internalSize_ = 0;
-            flush_current_buffer();
-            internalSize_ = temp;
+    static auto constexpr codes_per_block = 64;
+    static auto constexpr bits_per_word = 64;
+    using word_type = std::uint64_t;
+
+    if (codeSize <= 0)
+        return;
+    if (codeSize > bits_per_word)
+        throw std::runtime_error("push_stream::push_n: code size exceeds 64 bits");
+    auto current = codes.data();
+    auto end = current + codes.size();
+    auto packBlock = select_pack_block<S>(codeSize);
+    // leave room for at least one more word after each block (see push)
+    auto bytesRequired = (size_type)((codeSize + 1) * sizeof(word_type));
+    auto blockFits = [&]()
+            {
+                if constexpr (S == stream_direction::forward)
+                    return ((buffer_.end() - writePosition_) >= bytesRequired);
+                else
+                    return ((writePosition_ - buffer_.begin()) >= bytesRequired);
+            };
+    word_type words[bits_per_word];
+    while ((end - current) >= codes_per_block)
+    {
+        if (blockFits())
+        {
+            auto carry = accumulator_;
+            auto carrySize = accumulatorSize_;
+            do
+            {
+                packBlock(current, words);
+                for (auto i = 0; i < codeSize; ++i)
+                {
+                    word_type word;
+                    if constexpr (S == stream_direction::forward)
+                    {
+                        word = (carry | (words[i] >> carrySize));
+                        carry = (carrySize > 0) ? (words[i] << (bits_per_word - carrySize)) : 0;
+                    }
+                    else
+                    {
+                        word = (carry | (words[i] << carrySize));
+                        carry = (carrySize > 0) ? (words[i] >> (bits_per_word - carrySize)) : 0;
+                    }
+                    word = endian_swap<std::endian::native, std::endian::big>(word);
+                    if constexpr (S == stream_direction::forward)
+                    {
+                        std::memcpy(writePosition_, &word, sizeof(word));
+                        writePosition_ += sizeof(word);
+                    }
+                    else
+                    {
+                        writePosition_ -= sizeof(word);
+                        std::memcpy(writePosition_, &word, sizeof(word));
+                    }
+                }
+                current += codes_per_block;
+            } while (((end - current) >= codes_per_block) && (blockFits()));
+            accumulator_ = carry;
+        }
+        else
+        {
+            // block would cross the end (forward) or start (reverse) of the buffer
+            for (auto i = 0; i < codes_per_block; ++i)
+                push(*current++, codeSize);
         }
     }
+    // remaining codes
+    while (current < end)
+        push(*current++, codeSize);
 }
 
 
 //=============================================================================
-template <>
-inline void maniscalco::io::reverse_push_stream::align
+template <maniscalco::io::stream_direction S, typename Sink, typename Allocator>
+void maniscalco::io::basic_push_stream<S, Sink, Allocator>::push_bits
 (
-    // align bit stream to next byte boundary
+    // bit exact with pushing the bits one at a time.  the bits are moved a 
+    // word at a time by shifting and merging and, when both the source and
+    // the stream are at a byte boundary, copied directly into the buffer.
+    std::uint8_t const * source, 
+    size_type offset,
+    size_type count
 )
 {
-    if (internalSize_ & 0x07)
+    static auto constexpr bits_per_word = 64;
+    using word_type = std::uint64_t;
+
+    if (count <= 0)
+        return;
+    // bytes which can be copied into the buffer while leaving room for one 
+    // more word (see push)
+    auto room = [&]() -> size_type
+            {
+                if constexpr (S == stream_direction::forward)
+                    return ((buffer_.end() - writePosition_) - (size_type)sizeof(word_type));
+                else
+                    return ((writePosition_ - buffer_.begin()) - (size_type)sizeof(word_type));
+            };
+
+    if constexpr (S == stream_direction::forward)
     {
-        auto n = (8 - internalSize_ & 0x07);
-        push(0, n);
+        auto end = (offset + count);
+        if (auto n = std::min<size_type>((bits_per_byte - (offset & 0x07)) & 0x07, count); n > 0)
+        {
+            // bring the source to a byte boundary
+            push(load_bits(source, offset, n), n);
+            offset += n;
+        }
+        while ((end - offset) >= bits_per_word)
+        {
+            if (drain_accumulator())
+            {
+                if (auto n = std::min<size_type>((end - offset) / bits_per_byte, room()); n > 0)
+                {
+                    std::memcpy(writePosition_, source + (offset / bits_per_byte), n);
+                    writePosition_ += n;
+                    offset += (n * bits_per_byte);
+                }
+                if (room() < 0)
+                {
+                    flush_current_buffer();
+                    continue;
+                }
+                if ((end - offset) < bits_per_word)
+                    break;
+            }
+            else if (auto words = std::min<size_type>((end - offset) / bits_per_word, room() / (size_type)sizeof(word_type)); words > 0)
+            {
+                // shift and merge whole words while they fit in the buffer.  the
+                // source is byte aligned here.  locals so that the stores are 
+                // not assumed to alias them.
+                auto carry = accumulator_;
+                auto carrySize = accumulatorSize_;
+                auto output = writePosition_;
+                for (auto i = 0; i < words; ++i)
+                {
+                    word_type code;
+                    std::memcpy(&code, source + (offset / bits_per_byte), sizeof(code));
+                    code = endian_swap<std::endian::big, std::endian::native>(code);
+                    auto word = endian_swap<std::endian::native, std::endian::big>(carry | (code >> carrySize));
+                    carry = (code << (bits_per_word - carrySize));
+                    std::memcpy(output, &word, sizeof(word));
+                    output += sizeof(word);
+                    offset += bits_per_word;
+                }
+                accumulator_ = carry;
+                writePosition_ = output;
+                continue;
+            }
+            push<bits_per_word>(load_bits(source, offset, bits_per_word));
+            offset += bits_per_word;
+        }
+        if (auto n = (end - offset); n > 0)
+            push(load_bits(source, offset, n), n);
+    }
+    else
+    {
+        auto top = (offset + count);
+        if (auto n = std::min<size_type>((top & 0x07), count); n > 0)
+        {
+            // bring the source to a byte boundary
+            push(load_bits(source, top - n, n), n);
+            top -= n;
+        }
+        while ((top - offset) >= bits_per_word)
+        {
+            if (drain_accumulator())
+            {
+                if (auto n = std::min<size_type>((top - offset) / bits_per_byte, room()); n > 0)
+                {
+                    writePosition_ -= n;
+                    std::memcpy(writePosition_, source + (top / bits_per_byte) - n, n);
+                    top -= (n * bits_per_byte);
+                }
+                if (room() < 0)
+                {
+                    flush_current_buffer();
+                    continue;
+                }
+                if ((top - offset) < bits_per_word)
+                    break;
+            }
+            else if (auto words = std::min<size_type>((top - offset) / bits_per_word, room() / (size_type)sizeof(word_type)); words > 0)
+            {
+                // shift and merge whole words while they fit in the buffer.  the
+                // source is byte aligned here.  locals so that the stores are 
+                // not assumed to alias them.
+                auto carry = accumulator_;
+                auto carrySize = accumulatorSize_;
+                auto output = writePosition_;
+                for (auto i = 0; i < words; ++i)
+                {
+                    top -= bits_per_word;
+                    word_type code;
+                    std::memcpy(&code, source + (top / bits_per_byte), sizeof(code));
+                    code = endian_swap<std::endian::big, std::endian::native>(code);
+                    auto word = endian_swap<std::endian::native, std::endian::big>(carry | (code << carrySize));
+                    carry = (code >> (bits_per_word - carrySize));
+                    output -= sizeof(word);
+                    std::memcpy(output, &word, sizeof(word));
+                }
+                accumulator_ = carry;
+                writePosition_ = output;
+                continue;
+            }
+            push<bits_per_word>(load_bits(source, top - bits_per_word, bits_per_word));
+            top -= bits_per_word;
+        }
+        if (auto n = (top - offset); n > 0)
+            push(load_bits(source, offset, n), n);
+    }
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S, typename Sink, typename Allocator>
+inline auto maniscalco::io::basic_push_stream<S, Sink, Allocator>::load_bits
+(
+    // bits [position, position + count) of source as a right aligned code.
+    // 0 < count <= 64.  only the bytes which hold those bits are read.
+    std::uint8_t const * source, 
+    size_type position,
+    size_type count
+) -> code_type
+{
+    auto first = source + (position >> 3);
+    auto offset = (position & 0x07);
+    auto bytes = ((offset + count + 7) >> 3);
+    code_type word = 0;
+    if (bytes >= (size_type)sizeof(word))
+    {
+        std::memcpy(&word, first, sizeof(word));
+        word = (endian_swap<std::endian::big, std::endian::native>(word) << offset);
+        if (bytes > (size_type)sizeof(word))
+            word |= (first[sizeof(word)] >> (bits_per_byte - offset));
     }
+    else
+    {
+        for (auto i = 0; i < bytes; ++i)
+            word |= ((code_type)first[i] << (56 - (i * bits_per_byte)));
+        word <<= offset;
+    }
+    return (word >> (64 - count));
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S, typename Sink, typename Allocator>
+inline bool maniscalco::io::basic_push_stream<S, Sink, Allocator>::drain_accumulator
+(
+    // when the stream is at a byte boundary write the accumulated bytes so 
+    // that further bytes can be copied directly into the buffer.  returns
+    // false if the stream is not byte aligned.
+)
+{
+    if ((accumulatorSize_ & 0x07) != 0)
+        return false;
+    if (accumulatorSize_ > 0)
+    {
+        // push() always leaves room for at least one more word
+        auto word = endian_swap<std::endian::native, std::endian::big>(accumulator_);
+        if constexpr (S == stream_direction::forward)
+        {
+            std::memcpy(writePosition_, &word, sizeof(word));
+            writePosition_ += (accumulatorSize_ / bits_per_byte);
+        }
+        else
+        {
+            std::memcpy(writePosition_ - sizeof(word), &word, sizeof(word));
+            writePosition_ -= (accumulatorSize_ / bits_per_byte);
+        }
+        accumulator_ = 0;
+        accumulatorSize_ = 0;
+    }
+    return true;
 }
+
+namespace maniscalco::io
+{
+    // compiled once in push_stream.cpp
+    extern template class basic_push_stream<stream_direction::forward, 
+            std::function<void(stream_packet<stream_direction::forward>)>, std::function<buffer()>>;
+    extern template class basic_push_stream<stream_direction::reverse, 
+            std::function<void(stream_packet<stream_direction::reverse>)>, std::function<buffer()>>;
+
+} // maniscalco::io
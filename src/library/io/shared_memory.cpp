@@ -0,0 +1,438 @@
+#include "./shared_memory.h"
+
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace
+{
+
+    using size_type = std::int64_t;
+    static auto constexpr bits_per_byte = 8;
+    static auto constexpr cache_line_size = 64;
+    static std::uint64_t constexpr segment_magic = 0x4d414e4953484d31ull; // "MANISHM1"
+    // pop_stream may read up to 8 bytes beyond the end of a packet
+    static size_type constexpr slot_slack = cache_line_size;
+
+
+    struct segment_header
+    {
+        std::atomic<std::uint64_t> magic_;
+        std::int32_t direction_;
+        size_type slotCount_;
+        size_type slotSize_;
+        size_type slotStride_;
+        alignas(cache_line_size) std::atomic<std::uint64_t> head_;  // written by consumer
+        alignas(cache_line_size) std::atomic<std::uint64_t> tail_;  // written by producer
+        alignas(cache_line_size) std::atomic<std::uint32_t> closed_;
+    };
+
+    static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "shared memory transport requires lock free 64 bit atomics");
+
+
+    struct alignas(cache_line_size) slot_header
+    {
+        size_type startOffset_;
+        size_type endOffset_;
+    };
+
+
+    //=========================================================================
+    size_type slot_stride
+    (
+        size_type slotSize
+    )
+    {
+        auto size = (sizeof(slot_header) + slotSize + slot_slack);
+        return ((size + cache_line_size - 1) & ~(cache_line_size - 1));
+    }
+
+
+    //=========================================================================
+    void backoff
+    (
+        // spin, then yield, then sleep while waiting on the other process
+        std::int64_t attempt
+    )
+    {
+        if (attempt < (1 << 10))
+        {
+            #if defined(__x86_64__) || defined(__i386__)
+                __builtin_ia32_pause();
+            #endif
+        }
+        else if (attempt < (1 << 11))
+        {
+            std::this_thread::yield();
+        }
+        else
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+
+
+    //=========================================================================
+    class segment
+    {
+    public:
+
+        segment
+        (
+            int fd,
+            size_type size
+        ):
+            size_(size)
+        {
+            auto address = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (address == MAP_FAILED)
+                throw std::runtime_error("shared memory: failed to map segment");
+            address_ = reinterpret_cast<std::uint8_t *>(address);
+        }
+
+        ~segment()
+        {
+            ::munmap(address_, size_);
+        }
+
+        segment_header * header() const
+        {
+            return reinterpret_cast<segment_header *>(address_);
+        }
+
+        slot_header * slot(std::uint64_t index) const
+        {
+            auto header = this->header();
+            auto offset = (sizeof(segment_header) + 
+                    ((index % header->slotCount_) * header->slotStride_));
+            return reinterpret_cast<slot_header *>(address_ + offset);
+        }
+
+        std::uint8_t * slot_data(std::uint64_t index) const
+        {
+            return reinterpret_cast<std::uint8_t *>(slot(index) + 1);
+        }
+
+    private:
+
+        size_type size_;
+
+        std::uint8_t * address_;
+    };
+
+} // namespace
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+class maniscalco::io::shared_memory_producer<S>::state final
+{
+public:
+
+    state
+    (
+        configuration_type const & configuration
+    ):
+        name_(configuration.name_)
+    {
+        auto slotCount = std::max<size_type>(configuration.slotCount_, 2);
+        auto slotSize = configuration.slotSize_;
+        auto size = sizeof(segment_header) + (slotCount * slot_stride(slotSize));
+        auto fd = ::shm_open(name_.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0600);
+        if (fd < 0)
+            throw std::runtime_error("shared_memory_producer: failed to open " + name_);
+        if (::ftruncate(fd, size) != 0)
+        {
+            ::close(fd);
+            ::shm_unlink(name_.c_str());
+            throw std::runtime_error("shared_memory_producer: failed to size " + name_);
+        }
+        try
+        {
+            segment_ = std::make_unique<segment>(fd, size);
+        }
+        catch (...)
+        {
+            ::close(fd);
+            ::shm_unlink(name_.c_str());
+            throw;
+        }
+        ::close(fd);
+
+        auto header = segment_->header();
+        header->direction_ = (std::int32_t)S;
+        header->slotCount_ = slotCount;
+        header->slotSize_ = slotSize;
+        header->slotStride_ = slot_stride(slotSize);
+        header->head_.store(0, std::memory_order_relaxed);
+        header->tail_.store(0, std::memory_order_relaxed);
+        header->closed_.store(0, std::memory_order_relaxed);
+        header->magic_.store(segment_magic, std::memory_order_release);
+    }
+
+    ~state()
+    {
+        close();
+        segment_.reset();
+        ::shm_unlink(name_.c_str());
+    }
+
+    buffer allocate()
+    {
+        auto index = reserve();
+        return buffer(segment_->slot_data(index), segment_->header()->slotSize_, 
+                [s = this, index](auto *){s->unreserve(index);});
+    }
+
+    void publish
+    (
+        packet_type const & packet
+    )
+    {
+        auto header = segment_->header();
+        auto index = header->tail_.load(std::memory_order_relaxed);
+        if (index >= reservedTail_)
+            reserve();
+        auto destination = segment_->slot_data(index);
+        if (packet.data() != destination)
+        {
+            // packet was not allocated from this segment - copy it into the slot
+            auto [lo, hi] = std::minmax(packet.startOffset_, packet.endOffset_);
+            auto beginByte = (lo / bits_per_byte);
+            auto endByte = ((hi + bits_per_byte - 1) / bits_per_byte);
+            if (endByte > header->slotSize_)
+                throw std::runtime_error("shared_memory_producer: packet exceeds slot size");
+            std::memcpy(destination + beginByte, packet.data() + beginByte, endByte - beginByte);
+        }
+        auto slot = segment_->slot(index);
+        slot->startOffset_ = packet.startOffset_;
+        slot->endOffset_ = packet.endOffset_;
+        header->tail_.store(index + 1, std::memory_order_release);
+    }
+
+    void close()
+    {
+        if (segment_)
+            segment_->header()->closed_.store(1, std::memory_order_release);
+    }
+
+private:
+
+    std::uint64_t reserve()
+    {
+        // wait until the consumer has released the slot
+        auto header = segment_->header();
+        auto index = reservedTail_;
+        for (auto i = 0; (index - header->head_.load(std::memory_order_acquire)) >= (std::uint64_t)header->slotCount_; ++i)
+            backoff(i);
+        ++reservedTail_;
+        return index;
+    }
+
+    void unreserve
+    (
+        // invoked when a buffer allocated from this producer is destroyed.
+        // published slots now belong to the consumer.  the most recently 
+        // reserved slot is made available again if it was never published.
+        std::uint64_t index
+    )
+    {
+        if ((index >= segment_->header()->tail_.load(std::memory_order_relaxed)) && (index + 1 == reservedTail_))
+            --reservedTail_;
+    }
+
+    std::string name_;
+
+    std::unique_ptr<segment> segment_;
+
+    std::uint64_t reservedTail_{0};
+
+}; // class shared_memory_producer<S>::state
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+class maniscalco::io::shared_memory_consumer<S>::state final
+{
+public:
+
+    state
+    (
+        configuration_type const & configuration
+    )
+    {
+        auto const & name = configuration.name_;
+        auto fd = ::shm_open(name.c_str(), O_RDWR, 0600);
+        if (fd < 0)
+            throw std::runtime_error("shared_memory_consumer: failed to open " + name);
+        struct stat status;
+        if ((::fstat(fd, &status) != 0) || (status.st_size < (off_t)sizeof(segment_header)))
+        {
+            ::close(fd);
+            throw std::runtime_error("shared_memory_consumer: invalid segment " + name);
+        }
+        try
+        {
+            segment_ = std::make_unique<segment>(fd, status.st_size);
+        }
+        catch (...)
+        {
+            ::close(fd);
+            throw;
+        }
+        ::close(fd);
+
+        auto header = segment_->header();
+        if (header->magic_.load(std::memory_order_acquire) != segment_magic)
+            throw std::runtime_error("shared_memory_consumer: segment not initialized " + name);
+        if (header->direction_ != (std::int32_t)S)
+            throw std::runtime_error("shared_memory_consumer: stream direction mismatch " + name);
+        released_.resize(header->slotCount_, false);
+        readIndex_ = releaseIndex_ = header->head_.load(std::memory_order_acquire);
+    }
+
+    packet_type read()
+    {
+        auto header = segment_->header();
+        for (auto i = 0; readIndex_ >= header->tail_.load(std::memory_order_acquire); ++i)
+        {
+            if ((header->closed_.load(std::memory_order_acquire)) && 
+                (readIndex_ >= header->tail_.load(std::memory_order_acquire)))
+                return {};
+            backoff(i);
+        }
+        auto index = readIndex_++;
+        auto slot = segment_->slot(index);
+        return {buffer(segment_->slot_data(index), header->slotSize_, [s = this, index](auto *){s->release(index);}), 
+                slot->startOffset_, slot->endOffset_};
+    }
+
+private:
+
+    void release
+    (
+        // return slots to producer in ring order
+        std::uint64_t index
+    )
+    {
+        released_[index % released_.size()] = true;
+        auto start = releaseIndex_;
+        while ((releaseIndex_ < readIndex_) && (released_[releaseIndex_ % released_.size()]))
+            released_[releaseIndex_++ % released_.size()] = false;
+        if (releaseIndex_ != start)
+            segment_->header()->head_.store(releaseIndex_, std::memory_order_release);
+    }
+
+    std::unique_ptr<segment> segment_;
+
+    std::vector<bool> released_;
+
+    std::uint64_t readIndex_{0};
+
+    std::uint64_t releaseIndex_{0};
+
+}; // class shared_memory_consumer<S>::state
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+maniscalco::io::shared_memory_producer<S>::shared_memory_producer
+(
+    configuration_type const & configuration
+):
+    state_(std::make_unique<state>(configuration))
+{
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+maniscalco::io::shared_memory_producer<S>::~shared_memory_producer
+(
+)
+{
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+auto maniscalco::io::shared_memory_producer<S>::allocation_handler
+(
+) -> std::function<buffer()>
+{
+    return [s = state_.get()](){return s->allocate();};
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+auto maniscalco::io::shared_memory_producer<S>::output_handler
+(
+) -> std::function<void(packet_type)>
+{
+    return [s = state_.get()](packet_type packet){s->publish(packet);};
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+void maniscalco::io::shared_memory_producer<S>::close
+(
+    // signal end of stream to consumer
+)
+{
+    state_->close();
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+maniscalco::io::shared_memory_consumer<S>::shared_memory_consumer
+(
+    configuration_type const & configuration
+):
+    state_(std::make_unique<state>(configuration))
+{
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+maniscalco::io::shared_memory_consumer<S>::~shared_memory_consumer
+(
+)
+{
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+auto maniscalco::io::shared_memory_consumer<S>::input_handler
+(
+    // returns an empty packet once the producer has closed and all 
+    // published packets have been consumed
+) -> std::function<packet_type()>
+{
+    return [s = state_.get()](){return s->read();};
+}
+
+
+//=============================================================================
+namespace maniscalco::io
+{
+    template class shared_memory_producer<stream_direction::forward>;
+    template class shared_memory_producer<stream_direction::reverse>;
+    template class shared_memory_consumer<stream_direction::forward>;
+    template class shared_memory_consumer<stream_direction::reverse>;
+
+} // maniscalco
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "./buffer.h"
+#include "./stream_direction.h"
+#include "./stream_packet.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+
+namespace maniscalco::io
+{
+
+    // cross process transport over a POSIX shared memory ring of fixed size slots.
+    //
+    // producer process:
+    //   push_stream's bufferAllocationHandler_ = producer.allocation_handler()
+    //   push_stream's bufferOutputHandler_ = producer.output_handler()
+    // buffers are seated directly over free slots so push_stream encodes in 
+    // place and publishing a packet costs no copy.
+    //
+    // consumer process:
+    //   pop_stream's inputHandler_ = consumer.input_handler()
+    // packets are seated directly over published slots and each slot is 
+    // returned to the producer when the consumer's buffer is destroyed.
+    //
+    // both objects must outlive their handlers and any packets they produce.
+
+    template <stream_direction S>
+    class shared_memory_producer final
+    {
+    public:
+
+        using size_type = std::int64_t;
+        using packet_type = stream_packet<S>;
+
+        static size_type constexpr default_slot_count = 16;
+        static size_type constexpr default_slot_size = ((1 << 10) * 8);
+
+        struct configuration_type 
+        {
+            std::string name_;
+            size_type slotCount_{default_slot_count};
+            size_type slotSize_{default_slot_size};
+        };
+
+        shared_memory_producer(configuration_type const &);
+
+        shared_memory_producer(shared_memory_producer const &) = delete;
+        shared_memory_producer & operator = (shared_memory_producer const &) = delete;
+
+        ~shared_memory_producer();
+
+        std::function<buffer()> allocation_handler();
+
+        std::function<void(packet_type)> output_handler();
+
+        void close();
+
+    private:
+
+        class state;
+
+        std::unique_ptr<state> state_;
+
+    }; // class shared_memory_producer
+
+
+    template <stream_direction S>
+    class shared_memory_consumer final
+    {
+    public:
+
+        using size_type = std::int64_t;
+        using packet_type = stream_packet<S>;
+
+        struct configuration_type 
+        {
+            std::string name_;
+        };
+
+        shared_memory_consumer(configuration_type const &);
+
+        shared_memory_consumer(shared_memory_consumer const &) = delete;
+        shared_memory_consumer & operator = (shared_memory_consumer const &) = delete;
+
+        ~shared_memory_consumer();
+
+        std::function<packet_type()> input_handler();
+
+    private:
+
+        class state;
+
+        std::unique_ptr<state> state_;
+
+    }; // class shared_memory_consumer
+
+} // namespace maniscalco::io
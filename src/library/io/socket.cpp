@@ -0,0 +1,509 @@
+#include "./socket.h"
+#include "./packet_record.h"
+#include "./buffer_pool.h"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <vector>
+#include <algorithm>
+#include <climits>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+
+namespace
+{
+
+    using size_type = std::int64_t;
+    using record_header_type = maniscalco::io::packet_record::header_type;
+
+    #ifdef IOV_MAX
+        static size_type constexpr max_iov = IOV_MAX;
+    #else
+        static size_type constexpr max_iov = 1024;
+    #endif
+
+
+    //=========================================================================
+    [[noreturn]] void throw_system_error
+    (
+        char const * what
+    )
+    {
+        throw std::system_error(errno, std::generic_category(), what);
+    }
+
+
+    //=========================================================================
+    void advance
+    (
+        // consume 'count' bytes from the front of the iovec range
+        iovec * & iov,
+        size_type & iovCount,
+        size_type count
+    )
+    {
+        while ((iovCount > 0) && (count >= (size_type)iov->iov_len))
+        {
+            count -= iov->iov_len;
+            ++iov;
+            --iovCount;
+        }
+        if (iovCount > 0)
+        {
+            iov->iov_base = reinterpret_cast<std::uint8_t *>(iov->iov_base) + count;
+            iov->iov_len -= count;
+        }
+    }
+
+
+    //=========================================================================
+    void send_all
+    (
+        int socket,
+        iovec * iov,
+        size_type iovCount
+    )
+    {
+        while (iovCount > 0)
+        {
+            msghdr message{};
+            message.msg_iov = iov;
+            message.msg_iovlen = std::min(iovCount, max_iov);
+            auto sent = ::sendmsg(socket, &message, MSG_NOSIGNAL);
+            if (sent < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                throw_system_error("socket_output_handler: sendmsg failed");
+            }
+            advance(iov, iovCount, sent);
+        }
+    }
+
+
+    //=========================================================================
+    size_type receive_all
+    (
+        // returns number of bytes received.  less than requested only if
+        // the peer closed the connection.
+        int socket,
+        iovec * iov,
+        size_type iovCount
+    )
+    {
+        size_type total = 0;
+        while (iovCount > 0)
+        {
+            msghdr message{};
+            message.msg_iov = iov;
+            message.msg_iovlen = std::min(iovCount, max_iov);
+            auto received = ::recvmsg(socket, &message, MSG_WAITALL);
+            if (received < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                throw_system_error("socket_input_handler: recvmsg failed");
+            }
+            if (received == 0)
+                break;
+            total += received;
+            advance(iov, iovCount, received);
+        }
+        return total;
+    }
+
+} // namespace
+
+
+//=============================================================================
+int maniscalco::io::connect_unix_socket
+(
+    std::string const & path
+)
+{
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
+        throw std::invalid_argument("connect_unix_socket: path too long");
+    std::memcpy(address.sun_path, path.c_str(), path.size());
+    auto s = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (s < 0)
+        throw_system_error("connect_unix_socket: socket failed");
+    if (::connect(s, reinterpret_cast<sockaddr const *>(&address), sizeof(address)) != 0)
+    {
+        auto error = errno;
+        ::close(s);
+        errno = error;
+        throw_system_error("connect_unix_socket: connect failed");
+    }
+    return s;
+}
+
+
+//=============================================================================
+int maniscalco::io::listen_unix_socket
+(
+    std::string const & path,
+    int backlog
+)
+{
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
+        throw std::invalid_argument("listen_unix_socket: path too long");
+    std::memcpy(address.sun_path, path.c_str(), path.size());
+    auto s = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (s < 0)
+        throw_system_error("listen_unix_socket: socket failed");
+    ::unlink(path.c_str());
+    if ((::bind(s, reinterpret_cast<sockaddr const *>(&address), sizeof(address)) != 0) || (::listen(s, backlog) != 0))
+    {
+        auto error = errno;
+        ::close(s);
+        errno = error;
+        throw_system_error("listen_unix_socket: bind/listen failed");
+    }
+    return s;
+}
+
+
+//=============================================================================
+int maniscalco::io::connect_tcp_socket
+(
+    std::string const & host,
+    std::uint16_t port
+)
+{
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo * addresses = nullptr;
+    if (auto result = ::getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addresses); result != 0)
+        throw std::runtime_error(std::string("connect_tcp_socket: ") + ::gai_strerror(result));
+    auto s = -1;
+    for (auto address = addresses; ((s < 0) && (address != nullptr)); address = address->ai_next)
+    {
+        s = ::socket(address->ai_family, address->ai_socktype | SOCK_CLOEXEC, address->ai_protocol);
+        if ((s >= 0) && (::connect(s, address->ai_addr, address->ai_addrlen) != 0))
+        {
+            ::close(s);
+            s = -1;
+        }
+    }
+    ::freeaddrinfo(addresses);
+    if (s < 0)
+        throw_system_error("connect_tcp_socket: connect failed");
+    int enable = 1;
+    ::setsockopt(s, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+    return s;
+}
+
+
+//=============================================================================
+int maniscalco::io::listen_tcp_socket
+(
+    std::uint16_t port,
+    int backlog
+)
+{
+    auto s = ::socket(AF_INET6, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (s < 0)
+        throw_system_error("listen_tcp_socket: socket failed");
+    int enable = 1;
+    int disable = 0;
+    ::setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+    ::setsockopt(s, IPPROTO_IPV6, IPV6_V6ONLY, &disable, sizeof(disable));
+    sockaddr_in6 address{};
+    address.sin6_family = AF_INET6;
+    address.sin6_addr = in6addr_any;
+    address.sin6_port = htons(port);
+    if ((::bind(s, reinterpret_cast<sockaddr const *>(&address), sizeof(address)) != 0) || (::listen(s, backlog) != 0))
+    {
+        auto error = errno;
+        ::close(s);
+        errno = error;
+        throw_system_error("listen_tcp_socket: bind/listen failed");
+    }
+    return s;
+}
+
+
+//=============================================================================
+int maniscalco::io::accept_socket
+(
+    int listeningSocket
+)
+{
+    while (true)
+    {
+        auto s = ::accept4(listeningSocket, nullptr, nullptr, SOCK_CLOEXEC);
+        if (s >= 0)
+        {
+            int enable = 1;
+            ::setsockopt(s, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable)); // ignored for unix sockets
+            return s;
+        }
+        if (errno != EINTR)
+            throw_system_error("accept_socket: accept failed");
+    }
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+class maniscalco::io::socket_output_handler<S>::state final
+{
+public:
+
+    state
+    (
+        configuration_type const & configuration
+    ):
+        socket_(configuration.socket_),
+        batchSize_(std::clamp<size_type>(configuration.batchSize_, 1, max_iov / 2)),
+        closeSocket_(configuration.closeSocket_)
+    {
+        packets_.reserve(batchSize_);
+        headers_.reserve(batchSize_);
+        iov_.reserve(batchSize_ * 2);
+    }
+
+    ~state()
+    {
+        try
+        {
+            close();
+        }
+        catch (...)
+        {
+        }
+    }
+
+    void write
+    (
+        packet_type packet
+    )
+    {
+        headers_.push_back((record_header_type)packet.size());
+        packets_.emplace_back(std::move(packet));
+        if ((size_type)packets_.size() >= batchSize_)
+            flush();
+    }
+
+    void flush()
+    {
+        if (packets_.empty())
+            return;
+        iov_.clear();
+        for (auto i = 0ull; i < packets_.size(); ++i)
+        {
+            auto [data, numBytes] = packet_record::bytes(packets_[i]);
+            iov_.push_back({&headers_[i], sizeof(record_header_type)});
+            iov_.push_back({const_cast<std::uint8_t *>(data), (std::size_t)numBytes});
+        }
+        send_all(socket_, iov_.data(), iov_.size());
+        packets_.clear();
+        headers_.clear();
+    }
+
+    void close()
+    {
+        if (socket_ < 0)
+            return;
+        flush();
+        ::shutdown(socket_, SHUT_WR);
+        if (closeSocket_)
+            ::close(socket_);
+        socket_ = -1;
+    }
+
+private:
+
+    int socket_;
+
+    size_type const batchSize_;
+
+    bool const closeSocket_;
+
+    std::vector<packet_type> packets_;
+
+    std::vector<record_header_type> headers_;
+
+    std::vector<iovec> iov_;
+
+}; // class socket_output_handler<S>::state
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+class maniscalco::io::socket_input_handler<S>::state final
+{
+public:
+
+    state
+    (
+        configuration_type const & configuration
+    ):
+        socket_(configuration.socket_),
+        bufferAllocationHandler_(configuration.bufferAllocationHandler_ ? 
+                configuration.bufferAllocationHandler_ : buffer_allocation_handler(buffer_pool())),
+        closeSocket_(configuration.closeSocket_)
+    {
+    }
+
+    ~state()
+    {
+        if ((closeSocket_) && (socket_ >= 0))
+            ::close(socket_);
+    }
+
+    packet_type read()
+    {
+        // complete the header of this record if it did not arrive with the 
+        // previous record's data
+        if (headerSize_ < (size_type)sizeof(nextHeader_))
+        {
+            if ((peerClosed_) && (headerSize_ == 0))
+                return {};
+            iovec iov{(std::uint8_t *)&nextHeader_ + headerSize_, sizeof(nextHeader_) - headerSize_};
+            auto received = (peerClosed_) ? 0 : receive_all(socket_, &iov, 1);
+            if ((received == 0) && (headerSize_ == 0))
+            {
+                peerClosed_ = true;
+                return {};
+            }
+            if ((headerSize_ += received) != (size_type)sizeof(nextHeader_))
+                throw std::runtime_error("socket_input_handler: truncated record header");
+        }
+
+        // receive this record's data directly into the buffer
+        size_type numBits = nextHeader_;
+        auto numBytes = packet_record::byte_count(numBits);
+        auto data = bufferAllocationHandler_();
+        if (data.capacity() < numBytes)
+            data = buffer(numBytes);
+        iovec iov{data.data() + packet_record::data_offset<S>(data.capacity(), numBytes), (std::size_t)numBytes};
+        if (receive_all(socket_, &iov, 1) != numBytes)
+            throw std::runtime_error("socket_input_handler: truncated record");
+
+        // take the next record's header too if it has already arrived.  the
+        // record is never held back waiting for it (the peer may be waiting
+        // for a response to this record).
+        headerSize_ = 0;
+        while (true)
+        {
+            auto received = ::recv(socket_, &nextHeader_, sizeof(nextHeader_), MSG_DONTWAIT);
+            if (received > 0)
+                headerSize_ = received;
+            else if (received == 0)
+                peerClosed_ = true;
+            else if (errno == EINTR)
+                continue;
+            else if ((errno != EAGAIN) && (errno != EWOULDBLOCK))
+                throw_system_error("socket_input_handler: recv failed");
+            break;
+        }
+        return packet_record::make_packet<S>(std::move(data), numBits);
+    }
+
+private:
+
+    int socket_;
+
+    buffer_allocation_handler bufferAllocationHandler_;
+
+    bool const closeSocket_;
+
+    record_header_type nextHeader_{0};
+
+    // bytes of nextHeader_ received so far
+    size_type headerSize_{0};
+
+    bool peerClosed_{false};
+
+}; // class socket_input_handler<S>::state
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+maniscalco::io::socket_output_handler<S>::socket_output_handler
+(
+    configuration_type const & configuration
+):
+    state_(std::make_shared<state>(configuration))
+{
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+void maniscalco::io::socket_output_handler<S>::operator()
+(
+    packet_type packet
+)
+{
+    state_->write(std::move(packet));
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+void maniscalco::io::socket_output_handler<S>::flush
+(
+    // send any partially filled batch
+)
+{
+    state_->flush();
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+void maniscalco::io::socket_output_handler<S>::close
+(
+    // flush and shut down the sending side of the socket
+)
+{
+    state_->close();
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+maniscalco::io::socket_input_handler<S>::socket_input_handler
+(
+    configuration_type const & configuration
+):
+    state_(std::make_shared<state>(configuration))
+{
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S>
+auto maniscalco::io::socket_input_handler<S>::operator()
+(
+) -> packet_type
+{
+    return state_->read();
+}
+
+
+//=============================================================================
+namespace maniscalco::io
+{
+    template class socket_output_handler<stream_direction::forward>;
+    template class socket_output_handler<stream_direction::reverse>;
+    template class socket_input_handler<stream_direction::forward>;
+    template class socket_input_handler<stream_direction::reverse>;
+
+} // maniscalco
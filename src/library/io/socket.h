@@ -0,0 +1,111 @@
+#pragma once
+
+#include "./buffer.h"
+#include "./stream_direction.h"
+#include "./stream_packet.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+
+namespace maniscalco::io
+{
+
+    // connection helpers - return a connected (or listening) socket descriptor
+    // or throw std::system_error
+    int connect_unix_socket(std::string const & path);
+    int listen_unix_socket(std::string const & path, int backlog = 16);
+    int connect_tcp_socket(std::string const & host, std::uint16_t port);
+    int listen_tcp_socket(std::uint16_t port, int backlog = 16);
+    int accept_socket(int listeningSocket);
+
+
+    // writes packets to a connected stream socket as packet_records 
+    // (see packet_record.h).  up to 'batchSize_' packets are coalesced into
+    // a single sendmsg.  call flush() (or close()) to send a partial batch.
+    template <stream_direction S>
+    class socket_output_handler final
+    {
+    public:
+
+        using size_type = std::int64_t;
+        using packet_type = stream_packet<S>;
+
+        static size_type constexpr default_batch_size = 16;
+
+        struct configuration_type 
+        {
+            int socket_{-1};
+            size_type batchSize_{default_batch_size};
+            bool closeSocket_{true};
+        };
+
+        socket_output_handler(configuration_type const &);
+
+        // copies share the same socket and pending batch
+        socket_output_handler(socket_output_handler const &) = default;
+        socket_output_handler & operator = (socket_output_handler const &) = default;
+
+        ~socket_output_handler() = default;
+
+        void operator()
+        (
+            packet_type
+        );
+
+        void flush();
+
+        void close();
+
+    private:
+
+        class state;
+
+        std::shared_ptr<state> state_;
+
+    }; // class socket_output_handler
+
+
+    // reads packet_records from a connected stream socket.  each record's data
+    // is received directly into a buffer provided by 'bufferAllocationHandler_'
+    // (typically a buffer_pool) and the following record's header is taken 
+    // without blocking if it has already arrived.  a packet is returned as soon
+    // as its own data has arrived.  returns an empty packet once the peer 
+    // closes.
+    template <stream_direction S>
+    class socket_input_handler final
+    {
+    public:
+
+        using size_type = std::int64_t;
+        using packet_type = stream_packet<S>;
+        using buffer_allocation_handler = std::function<buffer()>;
+
+        struct configuration_type 
+        {
+            int socket_{-1};
+            buffer_allocation_handler bufferAllocationHandler_;
+            bool closeSocket_{true};
+        };
+
+        socket_input_handler(configuration_type const &);
+
+        // copies share the same socket
+        socket_input_handler(socket_input_handler const &) = default;
+        socket_input_handler & operator = (socket_input_handler const &) = default;
+
+        ~socket_input_handler() = default;
+
+        packet_type operator()();
+
+    private:
+
+        class state;
+
+        std::shared_ptr<state> state_;
+
+    }; // class socket_input_handler
+
+} // namespace maniscalco::io
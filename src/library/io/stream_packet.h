@@ -28,6 +28,8 @@ namespace maniscalco::io
 
         stream_packet(stream_packet &&) = default;
 
+        stream_packet & operator = (stream_packet &&) = default;
+
         auto size() const
         {
             if constexpr (S == stream_direction::forward)
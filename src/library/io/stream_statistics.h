@@ -0,0 +1,249 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <algorithm>
+#include <utility>
+
+
+namespace maniscalco::io
+{
+
+    // push_stream and pop_stream record statistics only when the library is
+    // built with IO_ENABLE_STATISTICS defined (cmake -DIO_ENABLE_STATISTICS=ON).
+    // otherwise every recording call is an empty inline function and the
+    // recorder occupies no storage.
+    #if defined(IO_ENABLE_STATISTICS)
+        static bool constexpr statistics_enabled = true;
+    #else
+        static bool constexpr statistics_enabled = false;
+    #endif
+
+
+    // histogram of durations using power of two nanosecond buckets.
+    // bucket i counts durations in [2^(i - 1), 2^i) ns (bucket 0 is < 1ns)
+    class latency_histogram final
+    {
+    public:
+
+        using size_type = std::int64_t;
+        using duration_type = std::chrono::nanoseconds;
+
+        static size_type constexpr bucket_count = 48;
+
+        void record
+        (
+            duration_type
+        );
+
+        size_type count() const;
+
+        size_type bucket
+        (
+            size_type
+        ) const;
+
+        // upper bound of the bucket which contains the given fraction [0, 1]
+        // of recorded durations
+        duration_type percentile
+        (
+            double
+        ) const;
+
+        duration_type total() const;
+
+        duration_type max() const;
+
+    private:
+
+        std::array<std::uint64_t, bucket_count> buckets_{};
+
+        std::uint64_t count_{0};
+
+        duration_type total_{0};
+
+        duration_type max_{0};
+
+    }; // class latency_histogram
+
+
+    struct stream_statistics
+    {
+        using size_type = std::int64_t;
+
+        size_type bits_{0};             // bits pushed or consumed
+        size_type packets_{0};          // packets output or input (excluding the empty end of stream packet)
+        size_type straddles_{0};        // codes split across two packets
+        size_type peekMisses_{0};       // peeks which could not be satisfied from the current packet
+        size_type alignPadding_{0};     // bits pushed or skipped by align()
+        latency_histogram handlerLatency_; // duration of each output or input handler call
+        latency_histogram allocationLatency_; // duration of each buffer allocation handler call (push_stream)
+    };
+
+
+    // records stream statistics.  the primary template is used when statistics
+    // are disabled and does nothing.
+    template <bool E = statistics_enabled>
+    class stream_statistics_recorder final
+    {
+    public:
+
+        using size_type = std::int64_t;
+
+        void count_packet(){}
+        void count_straddle(){}
+        void count_peek_miss(){}
+        void count_align_padding(size_type){}
+
+        template <typename F>
+        decltype(auto) time_handler
+        (
+            F && function
+        )
+        {
+            return function();
+        }
+
+        template <typename F>
+        decltype(auto) time_allocation
+        (
+            F && function
+        )
+        {
+            return function();
+        }
+
+        stream_statistics snapshot(size_type) const{return {};}
+    };
+
+
+    template <>
+    class stream_statistics_recorder<true> final
+    {
+    public:
+
+        using size_type = std::int64_t;
+
+        void count_packet(){++statistics_.packets_;}
+        void count_straddle(){++statistics_.straddles_;}
+        void count_peek_miss(){++statistics_.peekMisses_;}
+        void count_align_padding(size_type count){statistics_.alignPadding_ += count;}
+
+        template <typename F>
+        decltype(auto) time_handler
+        (
+            F && function
+        )
+        {
+            return time(statistics_.handlerLatency_, std::forward<F>(function));
+        }
+
+        template <typename F>
+        decltype(auto) time_allocation
+        (
+            F && function
+        )
+        {
+            return time(statistics_.allocationLatency_, std::forward<F>(function));
+        }
+
+        stream_statistics snapshot
+        (
+            size_type bits
+        ) const
+        {
+            auto result = statistics_;
+            result.bits_ = bits;
+            return result;
+        }
+
+    private:
+
+        template <typename F>
+        static decltype(auto) time
+        (
+            latency_histogram & histogram,
+            F && function
+        )
+        {
+            struct timer
+            {
+                ~timer(){histogram_.record(std::chrono::steady_clock::now() - start_);}
+                latency_histogram & histogram_;
+                std::chrono::steady_clock::time_point start_;
+            } t{histogram, std::chrono::steady_clock::now()};
+            return function();
+        }
+
+        stream_statistics statistics_;
+    };
+
+} // namespace maniscalco::io
+
+
+//=============================================================================
+inline void maniscalco::io::latency_histogram::record
+(
+    duration_type duration
+)
+{
+    auto nanoseconds = (std::uint64_t)std::max<duration_type::rep>(duration.count(), 0);
+    ++buckets_[std::min<size_type>(std::bit_width(nanoseconds), bucket_count - 1)];
+    ++count_;
+    total_ += duration;
+    max_ = std::max(max_, duration);
+}
+
+
+//=============================================================================
+inline auto maniscalco::io::latency_histogram::count
+(
+) const -> size_type
+{
+    return count_;
+}
+
+
+//=============================================================================
+inline auto maniscalco::io::latency_histogram::bucket
+(
+    size_type index
+) const -> size_type
+{
+    return buckets_[index];
+}
+
+
+//=============================================================================
+inline auto maniscalco::io::latency_histogram::percentile
+(
+    double fraction
+) const -> duration_type
+{
+    auto target = (std::uint64_t)(std::clamp(fraction, 0.0, 1.0) * count_);
+    std::uint64_t total = 0;
+    for (auto i = 0; i < bucket_count; ++i)
+        if ((total += buckets_[i]) >= std::max<std::uint64_t>(target, 1))
+            return std::min(duration_type(1ll << i), max_);
+    return max_;
+}
+
+
+//=============================================================================
+inline auto maniscalco::io::latency_histogram::total
+(
+) const -> duration_type
+{
+    return total_;
+}
+
+
+//=============================================================================
+inline auto maniscalco::io::latency_histogram::max
+(
+) const -> duration_type
+{
+    return max_;
+}
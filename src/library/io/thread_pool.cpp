@@ -0,0 +1,137 @@
+#include "./thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <utility>
+
+
+//=============================================================================
+maniscalco::io::thread_pool::thread_pool
+(
+    configuration_type const & configuration
+)
+{
+    auto threadCount = configuration.threadCount_;
+    if (threadCount <= 0)
+        threadCount = std::max<size_type>(std::thread::hardware_concurrency(), 1);
+    threads_.reserve(threadCount);
+    for (auto i = 0; i < threadCount; ++i)
+        threads_.emplace_back([this](){run();});
+}
+
+
+//=============================================================================
+maniscalco::io::thread_pool::~thread_pool
+(
+    // pending tasks are completed before the workers exit
+)
+{
+    {
+        std::lock_guard lock(mutex_);
+        terminate_ = true;
+    }
+    notEmpty_.notify_all();
+    for (auto & thread : threads_)
+        thread.join();
+}
+
+
+//=============================================================================
+void maniscalco::io::thread_pool::submit
+(
+    task_type task
+)
+{
+    {
+        std::lock_guard lock(mutex_);
+        tasks_.emplace_back(std::move(task));
+    }
+    notEmpty_.notify_one();
+}
+
+
+//=============================================================================
+auto maniscalco::io::thread_pool::size
+(
+) const -> size_type
+{
+    return threads_.size();
+}
+
+
+//=============================================================================
+void maniscalco::io::thread_pool::run
+(
+)
+{
+    std::unique_lock lock(mutex_);
+    while (true)
+    {
+        notEmpty_.wait(lock, [&](){return ((!tasks_.empty()) || (terminate_));});
+        if (tasks_.empty())
+            return;
+        auto task = std::move(tasks_.front());
+        tasks_.pop_front();
+        lock.unlock();
+        task();
+        lock.lock();
+    }
+}
+
+
+//=============================================================================
+void maniscalco::io::thread_pool::parallel_for
+(
+    size_type count,
+    std::function<void(size_type)> const & function
+)
+{
+    if (count <= 0)
+        return;
+
+    struct shared_state
+    {
+        std::atomic<size_type> next_{0};
+        std::mutex mutex_;
+        std::condition_variable done_;
+        size_type pending_{0};
+        std::exception_ptr error_;
+    };
+    auto shared = std::make_shared<shared_state>();
+
+    // each participant claims indices until none remain
+    auto work = [shared, &function, count]()
+            {
+                try
+                {
+                    for (auto i = shared->next_++; i < count; i = shared->next_++)
+                        function(i);
+                }
+                catch (...)
+                {
+                    std::lock_guard lock(shared->mutex_);
+                    if (!shared->error_)
+                        shared->error_ = std::current_exception();
+                    shared->next_ = count;
+                }
+            };
+
+    auto helperCount = std::min<size_type>(size(), count - 1);
+    shared->pending_ = helperCount;
+    for (auto i = 0; i < helperCount; ++i)
+        submit([shared, work]()
+                {
+                    work();
+                    std::lock_guard lock(shared->mutex_);
+                    if (--shared->pending_ == 0)
+                        shared->done_.notify_one();
+                });
+    work();
+
+    std::unique_lock lock(shared->mutex_);
+    shared->done_.wait(lock, [&](){return (shared->pending_ == 0);});
+    if (shared->error_)
+        std::rethrow_exception(shared->error_);
+}
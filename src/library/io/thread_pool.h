@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace maniscalco::io
+{
+
+    // fixed size pool of worker threads used by the parallel packet utilities
+    class thread_pool final
+    {
+    public:
+
+        using size_type = std::int64_t;
+        using task_type = std::function<void()>;
+
+        struct configuration_type
+        {
+            // zero selects std::thread::hardware_concurrency()
+            size_type threadCount_{0};
+        };
+
+        thread_pool(configuration_type const &);
+
+        thread_pool(thread_pool const &) = delete;
+        thread_pool & operator = (thread_pool const &) = delete;
+
+        ~thread_pool();
+
+        void submit
+        (
+            task_type
+        );
+
+        // invokes function(i) for every i in [0, count) across the pool and
+        // the calling thread.  blocks until complete and rethrows the first
+        // exception raised.  must not be called from a pool thread.
+        void parallel_for
+        (
+            size_type,
+            std::function<void(size_type)> const &
+        );
+
+        size_type size() const;
+
+    private:
+
+        void run();
+
+        std::mutex mutex_;
+
+        std::condition_variable notEmpty_;
+
+        std::deque<task_type> tasks_;
+
+        bool terminate_{false};
+
+        std::vector<std::thread> threads_;
+
+    }; // class thread_pool
+
+} // namespace maniscalco::io
@@ -0,0 +1,189 @@
+#include "./universal_code.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S, maniscalco::io::universal_code_type T>
+maniscalco::io::universal_code<S, T>::universal_code
+(
+    configuration_type const & configuration
+):
+    k_(configuration.parameter_)
+{
+    if ((k_ < 0) || (k_ > 63))
+        throw std::runtime_error("universal_code: parameter must be in the range [0, 63]");
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S, maniscalco::io::universal_code_type T>
+void maniscalco::io::universal_code<S, T>::encode_long
+(
+    // codes longer than 64 bits are written as zeros, the one and mantissa,
+    // and then the suffix
+    push_stream<S> & stream,
+    fields const & f
+) const
+{
+    for (auto zeros = f.zeros_; zeros > 0; )
+    {
+        auto n = std::min<size_type>(zeros, 64);
+        stream.push(0, n);
+        zeros -= n;
+    }
+    if constexpr (S == stream_direction::forward)
+        stream.push((1ull << f.mantissaSize_) | f.mantissa_, f.mantissaSize_ + 1);
+    else
+        stream.push((f.mantissa_ << 1) | 1, f.mantissaSize_ + 1);
+    if (f.suffixSize_ > 0)
+        stream.push(f.suffix_, f.suffixSize_);
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S, maniscalco::io::universal_code_type T>
+auto maniscalco::io::universal_code<S, T>::decode_slow
+(
+    // used for codes longer than 64 bits and where peek can not supply 64 bits
+    // (near the end of a packet)
+    pop_stream<S> & stream
+) const -> value_type
+{
+    size_type maxZeros = 63;
+    if constexpr (T == universal_code_type::elias_delta)
+        maxZeros = 6;
+    else if constexpr (T == universal_code_type::exp_golomb)
+        maxZeros = (63 - k_);
+    else if constexpr (T == universal_code_type::golomb_rice)
+        maxZeros = ((k_ == 0) ? ~0ull >> 1 : ((1ull << (64 - k_)) - 1));
+
+    size_type zeros = 0;
+    while (stream.pop(1) == 0)
+        if (++zeros > maxZeros)
+            throw std::runtime_error("universal_code: invalid code");
+
+    size_type mantissaSize;
+    if constexpr ((T == universal_code_type::elias_gamma) || (T == universal_code_type::elias_delta))
+        mantissaSize = zeros;
+    else if constexpr (T == universal_code_type::golomb_rice)
+        mantissaSize = k_;
+    else
+        mantissaSize = zeros + k_;
+    value_type mantissa = (mantissaSize > 0) ? stream.pop(mantissaSize) : 0;
+
+    if constexpr (T == universal_code_type::elias_gamma)
+    {
+        return ((1ull << zeros) | mantissa);
+    }
+    else if constexpr (T == universal_code_type::elias_delta)
+    {
+        auto suffixSize = (size_type)((1ull << zeros) | mantissa) - 1;
+        if (suffixSize > 63)
+            throw std::runtime_error("universal_code: invalid code");
+        return ((1ull << suffixSize) | ((suffixSize > 0) ? stream.pop(suffixSize) : 0));
+    }
+    else if constexpr (T == universal_code_type::golomb_rice)
+    {
+        return (((value_type)zeros << k_) | mantissa);
+    }
+    else
+    {
+        return (((1ull << mantissaSize) | mantissa) - (1ull << k_));
+    }
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S, maniscalco::io::universal_code_type T>
+void maniscalco::io::universal_code<S, T>::encode_n
+(
+    // gather codes into 64 bits at a time to reduce the number of pushes
+    push_stream<S> & stream,
+    std::span<value_type const> values
+) const
+{
+    std::uint64_t accumulator = 0;
+    size_type accumulatorSize = 0;
+    for (auto value : values)
+    {
+        auto f = make_fields(value);
+        std::uint64_t code = 0;
+        auto size = compose(f, code);
+        if ((accumulatorSize + size) > 64)
+        {
+            if (accumulatorSize > 0)
+                stream.push(accumulator, accumulatorSize);
+            accumulator = 0;
+            accumulatorSize = 0;
+            if (size > 64)
+            {
+                encode_long(stream, f);
+                continue;
+            }
+        }
+        if constexpr (S == stream_direction::forward)
+            accumulator = ((size == 64) ? code : ((accumulator << size) | code));
+        else
+            accumulator |= (code << accumulatorSize);
+        accumulatorSize += size;
+    }
+    if (accumulatorSize > 0)
+        stream.push(accumulator, accumulatorSize);
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S, maniscalco::io::universal_code_type T>
+void maniscalco::io::universal_code<S, T>::decode_n
+(
+    // decode as many codes as possible from each 64 bit peek
+    pop_stream<S> & stream,
+    std::span<value_type> values
+) const
+{
+    std::size_t i = 0;
+    while (i < values.size())
+    {
+        auto bits = stream.peek(64);
+        if (!bits)
+        {
+            values[i++] = decode_slow(stream);
+            continue;
+        }
+        auto remaining = *bits;
+        size_type available = 64;
+        while (i < values.size())
+        {
+            auto size = parse(remaining, available, values[i]);
+            if (size == 0)
+                break;
+            ++i;
+            available -= size;
+            if constexpr (S == stream_direction::forward)
+                remaining = ((size == 64) ? 0 : (remaining << size));
+            else
+                remaining = ((size == 64) ? 0 : (remaining >> size));
+        }
+        if (available == 64)
+            values[i++] = decode_slow(stream);
+        else
+            stream.discard(64 - available);
+    }
+}
+
+
+//=============================================================================
+namespace maniscalco::io
+{
+    template class universal_code<stream_direction::forward, universal_code_type::elias_gamma>;
+    template class universal_code<stream_direction::reverse, universal_code_type::elias_gamma>;
+    template class universal_code<stream_direction::forward, universal_code_type::elias_delta>;
+    template class universal_code<stream_direction::reverse, universal_code_type::elias_delta>;
+    template class universal_code<stream_direction::forward, universal_code_type::golomb_rice>;
+    template class universal_code<stream_direction::reverse, universal_code_type::golomb_rice>;
+    template class universal_code<stream_direction::forward, universal_code_type::exp_golomb>;
+    template class universal_code<stream_direction::reverse, universal_code_type::exp_golomb>;
+
+} // maniscalco
@@ -0,0 +1,298 @@
+#pragma once
+
+#include "./stream_direction.h"
+#include "./push_stream.h"
+#include "./pop_stream.h"
+
+#include <cstdint>
+#include <bit>
+#include <span>
+#include <stdexcept>
+
+
+namespace maniscalco::io
+{
+
+    enum class universal_code_type : std::uint32_t
+    {
+        elias_gamma,        // values >= 1
+        elias_delta,        // values >= 1
+        golomb_rice,        // values >= 0, parameter_ is k
+        exp_golomb          // values >= 0, parameter_ is k.  value + 2^k must not overflow
+    };
+
+
+    // every code is written as a run of zeros, a one, a mantissa whose size
+    // depends on the number of zeros and, for elias delta, a suffix.  each
+    // code of up to 64 bits is written with a single push and decoded with a
+    // single peek and a count of leading (forward) or trailing (reverse) zeros.
+    //
+    // forward streams write the fields msb first.  reverse streams write them
+    // lsb first so that the zeros are always the first bits that pop_stream
+    // returns.  the two directions are therefore not bit compatible.
+    //
+    // encode and encode_n throw std::runtime_error for values out of the range
+    // of the code (see universal_code_type).
+    template <stream_direction S, universal_code_type T>
+    class universal_code final
+    {
+    public:
+
+        using value_type = std::uint64_t;
+        using size_type = std::int64_t;
+
+        struct configuration_type
+        {
+            size_type parameter_{0};
+        };
+
+        universal_code() = default;
+
+        universal_code(configuration_type const &);
+
+        universal_code(universal_code const &) = default;
+        universal_code & operator = (universal_code const &) = default;
+
+        ~universal_code() = default;
+
+        void encode
+        (
+            push_stream<S> &,
+            value_type
+        ) const;
+
+        value_type decode
+        (
+            pop_stream<S> &
+        ) const;
+
+        void encode_n
+        (
+            push_stream<S> &,
+            std::span<value_type const>
+        ) const;
+
+        void decode_n
+        (
+            pop_stream<S> &,
+            std::span<value_type>
+        ) const;
+
+    private:
+
+        struct fields
+        {
+            size_type zeros_;
+            value_type mantissa_;
+            size_type mantissaSize_;
+            value_type suffix_;
+            size_type suffixSize_;
+        };
+
+        fields make_fields
+        (
+            value_type
+        ) const;
+
+        size_type compose
+        (
+            fields const &,
+            std::uint64_t &
+        ) const;
+
+        size_type parse
+        (
+            std::uint64_t,
+            size_type,
+            value_type &
+        ) const;
+
+        void encode_long
+        (
+            push_stream<S> &,
+            fields const &
+        ) const;
+
+        value_type decode_slow
+        (
+            pop_stream<S> &
+        ) const;
+
+        size_type k_{0};
+
+    }; // class universal_code
+
+
+    template <stream_direction S>
+    using elias_gamma_code = universal_code<S, universal_code_type::elias_gamma>;
+
+    template <stream_direction S>
+    using elias_delta_code = universal_code<S, universal_code_type::elias_delta>;
+
+    template <stream_direction S>
+    using golomb_rice_code = universal_code<S, universal_code_type::golomb_rice>;
+
+    template <stream_direction S>
+    using exp_golomb_code = universal_code<S, universal_code_type::exp_golomb>;
+
+} // namespace maniscalco::io
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S, maniscalco::io::universal_code_type T>
+inline auto maniscalco::io::universal_code<S, T>::make_fields
+(
+    value_type value
+) const -> fields
+{
+    if constexpr ((T == universal_code_type::elias_gamma) || (T == universal_code_type::elias_delta))
+    {
+        if (value == 0)
+            throw std::runtime_error("universal_code::encode: elias codes can not encode zero");
+    }
+    else if constexpr (T == universal_code_type::exp_golomb)
+    {
+        if (value > (~0ull - (1ull << k_)))
+            throw std::runtime_error("universal_code::encode: value + 2^k overflows");
+    }
+
+    if constexpr (T == universal_code_type::elias_gamma)
+    {
+        size_type n = std::bit_width(value);
+        return {n - 1, value & ((1ull << (n - 1)) - 1), n - 1, 0, 0};
+    }
+    else if constexpr (T == universal_code_type::elias_delta)
+    {
+        size_type n = std::bit_width(value);
+        size_type nn = std::bit_width((std::uint64_t)n);
+        return {nn - 1, (value_type)n & ((1ull << (nn - 1)) - 1), nn - 1, value & ((1ull << (n - 1)) - 1), n - 1};
+    }
+    else if constexpr (T == universal_code_type::golomb_rice)
+    {
+        return {(size_type)(value >> k_), value & ((1ull << k_) - 1), k_, 0, 0};
+    }
+    else
+    {
+        value += (1ull << k_);
+        size_type n = std::bit_width(value);
+        return {n - 1 - k_, value & ((1ull << (n - 1)) - 1), n - 1, 0, 0};
+    }
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S, maniscalco::io::universal_code_type T>
+inline auto maniscalco::io::universal_code<S, T>::compose
+(
+    // returns the code size.  code is only assembled when the size is <= 64
+    fields const & f,
+    std::uint64_t & code
+) const -> size_type
+{
+    auto size = (f.zeros_ + 1 + f.mantissaSize_ + f.suffixSize_);
+    if (size <= 64)
+    {
+        if constexpr (S == stream_direction::forward)
+            code = (((((1ull << f.mantissaSize_) | f.mantissa_) << f.suffixSize_) | f.suffix_));
+        else
+            code = ((((((f.suffix_ << f.mantissaSize_) | f.mantissa_) << 1) | 1) << f.zeros_));
+    }
+    return size;
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S, maniscalco::io::universal_code_type T>
+inline void maniscalco::io::universal_code<S, T>::encode
+(
+    push_stream<S> & stream,
+    value_type value
+) const
+{
+    auto f = make_fields(value);
+    std::uint64_t code = 0;
+    if (auto size = compose(f, code); size <= 64)
+        stream.push(code, size);
+    else
+        encode_long(stream, f);
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S, maniscalco::io::universal_code_type T>
+inline auto maniscalco::io::universal_code<S, T>::parse
+(
+    // decode one code from the first 'available' bits of 'bits' (as returned
+    // by peek).  returns the code size or zero if the code is not complete
+    // within those bits.
+    std::uint64_t bits,
+    size_type available,
+    value_type & value
+) const -> size_type
+{
+    auto extract = [bits](size_type offset, size_type count) -> std::uint64_t
+            {
+                if (count == 0)
+                    return 0;
+                if constexpr (S == stream_direction::forward)
+                    return ((bits << offset) >> (64 - count));
+                else
+                    return ((bits >> offset) & (~0ull >> (64 - count)));
+            };
+
+    size_type zeros = (S == stream_direction::forward) ? std::countl_zero(bits) : std::countr_zero(bits);
+    size_type mantissaSize;
+    if constexpr ((T == universal_code_type::elias_gamma) || (T == universal_code_type::elias_delta))
+        mantissaSize = zeros;
+    else if constexpr (T == universal_code_type::golomb_rice)
+        mantissaSize = k_;
+    else
+        mantissaSize = zeros + k_;
+
+    auto size = (zeros + 1 + mantissaSize);
+    if (size > available)
+        return 0;
+    auto mantissa = extract(zeros + 1, mantissaSize);
+
+    if constexpr (T == universal_code_type::elias_gamma)
+    {
+        value = ((1ull << zeros) | mantissa);
+    }
+    else if constexpr (T == universal_code_type::elias_delta)
+    {
+        auto suffixSize = (size_type)((1ull << zeros) | mantissa) - 1;
+        if ((size + suffixSize) > available)
+            return 0;
+        value = ((1ull << suffixSize) | extract(size, suffixSize));
+        size += suffixSize;
+    }
+    else if constexpr (T == universal_code_type::golomb_rice)
+    {
+        value = (((value_type)zeros << k_) | mantissa);
+    }
+    else
+    {
+        value = (((1ull << mantissaSize) | mantissa) - (1ull << k_));
+    }
+    return size;
+}
+
+
+//=============================================================================
+template <maniscalco::io::stream_direction S, maniscalco::io::universal_code_type T>
+inline auto maniscalco::io::universal_code<S, T>::decode
+(
+    pop_stream<S> & stream
+) const -> value_type
+{
+    if (auto bits = stream.peek(64); bits)
+    {
+        value_type value;
+        if (auto size = parse(*bits, 64, value); size > 0)
+        {
+            stream.discard(size);
+            return value;
+        }
+    }
+    return decode_slow(stream);
+}